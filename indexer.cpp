@@ -1,13 +1,11 @@
 #include <bits/stdc++.h>
 #include <filesystem>
-#include <nlohmann/json.hpp> // JSON library (nlohmann)
-using json = nlohmann::json;
+#include "src/barrel_writer.h"
+#include "src/body_text_extractor.h"
 
 using namespace std;
 namespace fs = std::filesystem;
 
-const int BARREL_SIZE = 1000; // words per barrel
-
 // ---------------- STRUCTS ----------------
 struct WordInfo {
     vector<int> positions;
@@ -17,6 +15,8 @@ struct WordInfo {
 // ---------------- GLOBALS ----------------
 unordered_map<string,int> lexicon; // word -> wordID
 int nextWordID = 0;
+BarrelWriterPool barrelWriters; // barrel/hitlist files stay open for the whole run
+BodyTextExtractor bodyExtractor; // reused for every JSON file
 
 // ---------------- UTIL - CLEAN & TOKENIZE ----------------
 string clean(const string &s) {
@@ -64,12 +64,6 @@ void saveLexicon(const string &path) {
     out.close();
 }
 
-// ---------------- FILE APPEND HELPERS ----------------
-void appendLine(const string &path, const string &line) {
-    ofstream out(path, ios::app);
-    out << line << "\n";
-}
-
 // ---------------- GET/ASSIGN WORD ID ----------------
 int getWordID(const string &w) {
     auto it = lexicon.find(w);
@@ -79,10 +73,6 @@ int getWordID(const string &w) {
     return id;
 }
 
-int getBarrelID(int wordID) {
-    return wordID / BARREL_SIZE;
-}
-
 // ---------------- PROCESS A SINGLE DOCUMENT ----------------
 void processDocument(const string &docID, const string &title,
                      const string &abstractText, const string &body) {
@@ -125,23 +115,10 @@ void processDocument(const string &docID, const string &title,
         int wordID = kv.first;
         int freq = (int)kv.second.positions.size();
         int priority = kv.second.priority;
-        int barrelID = getBarrelID(wordID);
-
-        string barrelPath = "data/barrels/barrel_" + to_string(barrelID) + ".csv";
-        string hitlistPath = "data/hitlists/hitlist_" + to_string(barrelID) + ".csv";
 
         // barrel: wordID,docID,freq
-        appendLine(barrelPath, to_string(wordID) + "," + docID + "," + to_string(freq));
-
         // hitlist: wordID,docID,freq,priority,pos1|pos2|...
-        string poslist;
-        for (int i = 0; i < (int)kv.second.positions.size(); ++i) {
-            if (i) poslist += "|";
-            poslist += to_string(kv.second.positions[i]);
-        }
-        appendLine(hitlistPath,
-                   to_string(wordID) + "," + docID + "," + to_string(freq) + "," +
-                   to_string(priority) + "," + poslist);
+        barrelWriters.write(wordID, docID, freq, priority, kv.second.positions.data(), kv.second.positions.size());
     }
 }
 
@@ -168,9 +145,9 @@ vector<string> splitCSVLine(const string &line) {
 }
 
 // ----------------- AGGREGATE POSTINGS PER BARREL (write postings.csv) -----------------
-// For each barrel id present in data/barrels, read corresponding hitlist file and
-// build postings entries for the words in that barrel and append to postings.csv
-void buildPostingsFromHitlists(const string &barrelDir, const string &hitlistDir, const string &outPostingsPath) {
+// For each hitlist file (one per barrel), build postings entries for the words
+// in that barrel and append to postings.csv
+void buildPostingsFromHitlists(const string &hitlistDir, const string &outPostingsPath) {
     // Ensure postings file has header
     ofstream pout(outPostingsPath);
     pout << "wordID,docIDs,freqPerDoc,priority,totalFrequency\n";
@@ -278,20 +255,10 @@ int main() {
         string bodyText;
         string jsonPath = jsonFolder + cord_id + ".json";
         if (fs::exists(jsonPath)) {
-            try {
-                ifstream jf(jsonPath);
-                json j; jf >> j;
-                if (j.contains("body_text") && j["body_text"].is_array()) {
-                    for (auto &p : j["body_text"]) {
-                        if (p.contains("text") && p["text"].is_string()) {
-                            bodyText += p["text"].get<string>() + " ";
-                        }
-                    }
-                }
-                jf.close();
-            } catch (...) {
-                // ignore parse errors for one document and continue
-            }
+            // body_text[].text and section names only; a malformed file
+            // keeps the paragraphs read before the error
+            bodyExtractor.parseFile(jsonPath);
+            bodyExtractor.appendBody(bodyText);
         }
 
         string combinedTitle = title + " " + authors;
@@ -309,8 +276,9 @@ int main() {
     cout << "Saved lexicon to " << lexPath << "\n";
 
     // Build postings.csv by reading hitlist files (per-barrel aggregation)
+    barrelWriters.flush();
     string postingsOut = "data/postings.csv";
-    buildPostingsFromHitlists("data/barrels", "data/hitlists", postingsOut);
+    buildPostingsFromHitlists("data/hitlists", postingsOut);
     cout << "Postings written to " << postingsOut << "\n";
 
     cout << "Indexing finished!\n";
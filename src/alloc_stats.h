@@ -0,0 +1,12 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <cstdint>
+
+// Heap allocations made by the calling thread so far. Counted by the
+// global operator new replacements in alloc_stats.cpp; link that file
+// into a program to enable them. Take the difference of two readings
+// to count the allocations of one step.
+uint64_t threadAllocations();
+
+#endif
@@ -10,12 +10,22 @@
 #include <sstream>
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <queue>
 #include <unordered_set>
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <cmath>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "levenshtein_automaton.h"
+#include "query_parser.h"
+#include "retrieval.h"
+#include "segments.h"
+#include "tokenizer.h"
 
 // Windows socket headers
 #ifdef _WIN32
@@ -38,16 +48,6 @@ using namespace std;
 // DATA STRUCTURES
 // ============================================
 
-// Structure to hold document metadata
-struct Document
-{
-    string docId;
-    string title;
-    string authors;
-    string abstract;
-    string url;
-};
-
 // Structure for search results with ranking score
 struct SearchResult
 {
@@ -59,111 +59,171 @@ struct SearchResult
     double score;
 };
 
-// ============================================
-// TRIE FOR AUTOCOMPLETE
-// ============================================
-struct TrieNode
+// Milliseconds spent in each stage of a search, reported with the results
+struct SearchTiming
 {
-    unordered_map<char, TrieNode *> children;
-    bool isEnd = false;
+    double retrieveMs = 0.0; // BM25 top-N
+    double rerankMs = 0.0;   // proximity re-scoring of the top RERANK_DEPTH
+    double fetchMs = 0.0;    // metadata of the returned page
+    double suggestMs = 0.0;  // "did you mean"
+    size_t reranked = 0;     // docs re-scored
 };
 
-class Trie
+// ============================================
+// AUTOCOMPLETE
+// ============================================
+// Every segment stores its words sorted and front-coded with each
+// word's df, so the completions of a prefix are one range per segment
+// and a TopCursor lists that range most frequent first. Across segments
+// the cursors are merged with a threshold: a word no cursor has reached
+// yet can total at most the sum of the cursors' next weights, so once
+// `limit` words are known to beat that, the rest are never read. The
+// cost grows with the prefix length and `limit`, not the range size.
+vector<string> exactCompletions(const SegmentedIndex &index, const string &prefix, size_t limit)
 {
-private:
-    TrieNode *root;
-
-    void dfs(TrieNode *node, string prefix, vector<string> &results, int limit) const
+    vector<PrefixDictionary::TopCursor> cursors;
+    for (size_t s = 0; s < index.segmentCount(); s++)
     {
-        if ((int)results.size() >= limit)
-            return;
-        if (node->isEnd)
-            results.push_back(prefix);
-        for (auto &p : node->children)
-        {
-            dfs(p.second, prefix + p.first, results, limit);
-        }
+        const PrefixDictionary &dict = index.segment(s).completions();
+        cursors.emplace_back(dict, dict.prefixRange(prefix));
     }
 
-public:
-    Trie() { root = new TrieNode(); }
-
-    void insert(const string &word)
+    vector<pair<uint64_t, string>> found; // total df, word
+    unordered_set<string> seen;
+    priority_queue<uint64_t, vector<uint64_t>, greater<uint64_t>> best; // top `limit` totals
+    string word;
+    while (limit > 0)
     {
-        TrieNode *node = root;
-        for (char c : word)
+        uint64_t threshold = 0;
+        size_t next = 0;
+        for (size_t s = 0; s < cursors.size(); s++)
         {
-            if (!node->children[c])
-                node->children[c] = new TrieNode();
-            node = node->children[c];
+            threshold += cursors[s].nextWeight();
+            if (cursors[s].nextWeight() > cursors[next].nextWeight())
+                next = s;
         }
-        node->isEnd = true;
+        // With one segment the cursor order is already df then word,
+        // so ties at the threshold can stop too
+        if (best.size() == limit && (best.top() > threshold || (cursors.size() == 1 && best.top() == threshold)))
+            break;
+
+        uint32_t wordIndex;
+        if (!cursors[next].next(wordIndex))
+            break; // every cursor is exhausted
+        index.segment(next).completions().word(wordIndex, word);
+        if (!seen.insert(word).second)
+            continue;
+
+        uint64_t total = 0;
+        for (size_t s = 0; s < index.segmentCount(); s++)
+            total += index.segment(s).docFrequency(word);
+        found.emplace_back(total, word);
+        best.push(total);
+        if (best.size() > limit)
+            best.pop();
     }
 
-    vector<string> autocomplete(const string &prefix, int limit = 10) const
+    sort(found.begin(), found.end(), [](const pair<uint64_t, string> &x, const pair<uint64_t, string> &y)
+         { return x.first != y.first ? x.first > y.first : x.second < y.second; });
+    vector<string> words;
+    for (size_t i = 0; i < found.size() && i < limit; i++)
+        words.push_back(found[i].second);
+    return words;
+}
+
+// Typo-tolerant completions fill whatever the exact ones leave: words
+// with the same first letter and a prefix within 1 edit of a 3-6 letter
+// prefix, or 2 edits of a longer one, nearest first, then by df. Each segment's dictionary is
+// walked as a trie with a Levenshtein automaton (levenshtein_automaton.h),
+// and the `limit` most frequent words of every matching subtree are the
+// candidates; with several segments that uses per-segment df, so a rare
+// word spread over many segments can be missed until they are merged.
+// One budget covers the trie nodes and candidates of a request, so a
+// short prefix or a large lexicon cannot make a keystroke slow.
+const size_t FUZZY_BUDGET = 4000;
+const size_t MAX_FUZZY_PREFIX = 32;
+
+void addFuzzyCompletions(const SegmentedIndex &index, const string &prefix, size_t limit, vector<string> &words)
+{
+    uint32_t maxDistance = prefix.size() > 6 ? 2 : prefix.size() >= 3 ? 1 : 0;
+    if (words.size() >= limit || maxDistance == 0 || prefix.size() > MAX_FUZZY_PREFIX)
+        return;
+
+    struct Candidate
     {
-        TrieNode *node = root;
-        for (char c : prefix)
+        uint32_t distance;
+        uint64_t df;
+        string word;
+    };
+    LevenshteinAutomaton automaton(prefix, maxDistance);
+    unordered_set<string> seen(words.begin(), words.end());
+    vector<Candidate> candidates;
+    vector<FuzzyRange> ranges;
+    string word;
+    size_t budget = FUZZY_BUDGET;
+    for (size_t s = 0; s < index.segmentCount() && budget > 0; s++)
+    {
+        const PrefixDictionary &dict = index.segment(s).completions();
+        ranges.clear();
+        fuzzyPrefixRanges(dict, automaton, 1, budget, ranges);
+        for (const FuzzyRange &r : ranges)
         {
-            if (!node->children.count(c))
-                return {};
-            node = node->children[c];
+            PrefixDictionary::TopCursor cursor(dict, {r.first, r.last});
+            uint32_t wordIndex;
+            for (size_t n = 0; n < limit && budget > 0 && cursor.next(wordIndex); n++, budget--)
+            {
+                dict.word(wordIndex, word);
+                if (!seen.insert(word).second)
+                    continue;
+                uint64_t total = 0;
+                for (size_t t = 0; t < index.segmentCount(); t++)
+                    total += index.segment(t).docFrequency(word);
+                candidates.push_back({automaton.prefixDistance(word), total, word});
+            }
         }
-        vector<string> results;
-        dfs(node, prefix, results, limit);
-        return results;
     }
-};
+
+    sort(candidates.begin(), candidates.end(), [](const Candidate &x, const Candidate &y)
+         {
+             if (x.distance != y.distance)
+                 return x.distance < y.distance;
+             return x.df != y.df ? x.df > y.df : x.word < y.word;
+         });
+    for (size_t i = 0; i < candidates.size() && words.size() < limit; i++)
+        words.push_back(candidates[i].word);
+}
+
+vector<string> autocomplete(const SegmentedIndex &index, const string &prefix, size_t limit)
+{
+    vector<string> words = exactCompletions(index, prefix, limit);
+    addFuzzyCompletions(index, prefix, limit, words);
+    return words;
+}
 
 // ============================================
 // GLOBAL DATA (loaded at startup)
 // ============================================
-unordered_map<string, int> lexicon;                     // word -> wordID
-unordered_map<string, Document> documents;              // docId -> document info
-unordered_map<int, vector<pair<string, int>>> postings; // wordID -> [(docId, freq)]
-unordered_map<string, string> docUrls;                  // docId -> URL
-Trie autocompleteTrie;                                  // Trie for word suggestions
-
-// BM25 Parameters and Statistics
-unordered_map<string, int> docLengths; // docId -> document length (total terms)
-unordered_map<int, int> docFrequency;  // wordID -> number of documents containing this word
-double avgDocLength = 0.0;             // Average document length
-int totalDocuments = 0;                // Total number of documents
+// Documents are addressed by dense doc number (0..totalDocuments-1)
+// everywhere; cord_ids are only looked up for the final results.
+// The segment set is replaced as a whole when the manifest changes; a
+// search keeps its own reference, so a swap never affects it.
+const string segmentDir = "data/segments";
+shared_ptr<const SegmentedIndex> liveIndex; // mapped segments
+mutex indexMutex;                           // guards liveIndex
 
 // BM25 tuning parameters
 const double k1 = 1.5; // Term frequency saturation parameter
 const double b = 0.75; // Document length normalization parameter
 
+// BM25F field weights, settable per request as title=, abstract= and
+// body=; the defaults are Bm25's
+const char *const FIELD_WEIGHT_PARAMS[SCORED_FIELDS] = {"title", "abstract", "body"};
+const double MAX_FIELD_WEIGHT = 100.0;
+
 // ============================================
 // HELPER FUNCTIONS
 // ============================================
 
-// Clean and tokenize text (same as tokenizer.cpp)
-string cleanText(const string &text)
-{
-    string result = text;
-    for (char &c : result)
-    {
-        if (!isalpha((unsigned char)c))
-            c = ' ';
-        else
-            c = tolower((unsigned char)c);
-    }
-    return result;
-}
-
-vector<string> tokenize(const string &text)
-{
-    vector<string> words;
-    stringstream ss(cleanText(text));
-    string word;
-    while (ss >> word)
-    {
-        words.push_back(word);
-    }
-    return words;
-}
-
 // URL decode function for handling spaces and special chars
 string urlDecode(const string &str)
 {
@@ -189,186 +249,123 @@ string urlDecode(const string &str)
     return result;
 }
 
-// Extract query parameter from URL
-string getQueryParam(const string &request)
+// Extract a query parameter from the request line, "" if absent
+string getQueryParam(const string &request, const string &name = "q")
 {
-    size_t qPos = request.find("?q=");
-    if (qPos == string::npos)
+    // "GET /search?q=...&k=... HTTP/1.1": the target ends at a space
+    size_t start = request.find('?');
+    size_t lineEnd = request.find_first_of(" \r\n", request.find(' ') + 1);
+    if (start == string::npos || start > lineEnd)
         return "";
 
-    size_t start = qPos + 3;
-    size_t end = request.find(" ", start);
-    if (end == string::npos)
-        end = request.find("&", start);
-    if (end == string::npos)
-        end = request.length();
+    while (start < lineEnd)
+    {
+        start++; // past '?' or '&'
+        size_t end = min(request.find('&', start), lineEnd);
+        if (request.compare(start, name.size(), name) == 0 && request[start + name.size()] == '=')
+        {
+            size_t valueStart = start + name.size() + 1;
+            return urlDecode(request.substr(valueStart, end - valueStart));
+        }
+        start = end;
+    }
+    return "";
+}
 
-    return urlDecode(request.substr(start, end - start));
+// A non-negative integer parameter, clamped to maxValue; fallback if
+// it is absent or not a number
+size_t getCountParam(const string &request, const string &name, size_t fallback, size_t maxValue)
+{
+    string value = getQueryParam(request, name);
+    if (value.empty() || value.find_first_not_of("0123456789") != string::npos)
+        return fallback;
+    return value.size() > 9 ? maxValue : min<size_t>(stoul(value), maxValue);
+}
+
+// A non-negative decimal parameter, clamped to maxValue; fallback if it
+// is absent or not a number
+double getWeightParam(const string &request, const string &name, double fallback, double maxValue)
+{
+    string value = getQueryParam(request, name);
+    if (value.empty() || value.find_first_not_of("0123456789.") != string::npos)
+        return fallback;
+    char *end;
+    double weight = strtod(value.c_str(), &end);
+    return *end != '\0' ? fallback : min(weight, maxValue);
 }
 
 // ============================================
 // DATA LOADING FUNCTIONS
 // ============================================
 
-void loadLexicon(const string &path)
+shared_ptr<const SegmentedIndex> currentIndex()
 {
-    ifstream file(path);
-    if (!file.is_open())
-    {
-        cerr << "Warning: Could not open lexicon at " << path << endl;
-        return;
-    }
-
-    string line;
-    getline(file, line); // Skip header
-
-    while (getline(file, line))
-    {
-        stringstream ss(line);
-        string word;
-        int id;
-        getline(ss, word, ',');
-        ss >> id;
-        lexicon[word] = id;
-        autocompleteTrie.insert(word); // Build trie for autocomplete
-    }
-
-    cout << "Loaded " << lexicon.size() << " words from lexicon" << endl;
+    lock_guard<mutex> lock(indexMutex);
+    return liveIndex;
 }
 
-void loadPostings(const string &path)
+// Segments are mapped and used in place; nothing is parsed or built
+// here, autocomplete included.
+void installIndex(shared_ptr<const SegmentedIndex> index)
 {
-    ifstream file(path);
-    if (!file.is_open())
-    {
-        cerr << "Warning: Could not open postings at " << path << endl;
-        return;
-    }
-
-    string line;
-    getline(file, line); // Skip header
-
-    while (getline(file, line))
-    {
-        stringstream ss(line);
-        int wordId;
-        string docIds, freqs;
-
-        ss >> wordId;
-        ss.ignore();
-        getline(ss, docIds, ',');
-        getline(ss, freqs, ',');
-
-        // Parse document IDs and frequencies
-        vector<string> docs;
-        vector<int> frequencies;
-
-        stringstream docSS(docIds);
-        string doc;
-        while (getline(docSS, doc, ';'))
-        {
-            docs.push_back(doc);
-        }
-
-        stringstream freqSS(freqs);
-        string freq;
-        while (getline(freqSS, freq, ';'))
-        {
-            frequencies.push_back(stoi(freq));
-        }
-
-        // Track document frequency for IDF calculation
-        docFrequency[wordId] = docs.size();
-
-        for (size_t i = 0; i < docs.size() && i < frequencies.size(); i++)
-        {
-            postings[wordId].push_back({docs[i], frequencies[i]});
-            // Track document lengths for BM25 normalization
-            docLengths[docs[i]] += frequencies[i];
-        }
-    }
-
-    // Calculate average document length
-    long long totalLength = 0;
-    for (const auto &dl : docLengths)
-    {
-        totalLength += dl.second;
-    }
-    totalDocuments = docLengths.size();
-    avgDocLength = totalDocuments > 0 ? (double)totalLength / totalDocuments : 1.0;
-
-    cout << "Loaded postings for " << postings.size() << " words" << endl;
-    cout << "Total documents: " << totalDocuments << ", Avg doc length: " << avgDocLength << endl;
+    lock_guard<mutex> lock(indexMutex);
+    liveIndex = index;
 }
 
-void loadDocuments(const string &path)
+// Serves data/segments when it has a manifest, else the single image
+// written by build_index_image.
+void loadIndex(const string &imagePath)
 {
-    ifstream file(path);
-    if (!file.is_open())
-    {
-        cerr << "Warning: Could not open documents at " << path << endl;
-        return;
-    }
-
-    string line;
-    getline(file, line); // Skip header
-
-    while (getline(file, line))
+    auto startTime = chrono::high_resolution_clock::now();
+    auto index = make_shared<SegmentedIndex>();
+    string source = segmentDir;
+    if (!index->open(segmentDir))
     {
-        if (line.empty())
-            continue;
-
-        // Simple CSV parsing (handles basic cases)
-        vector<string> cols;
-        stringstream ss(line);
-        string col;
-
-        while (getline(ss, col, ','))
-        {
-            cols.push_back(col);
-        }
-
-        if (cols.size() >= 5)
+        index = make_shared<SegmentedIndex>();
+        source = imagePath;
+        if (!index->openImage(imagePath))
         {
-            Document doc;
-            doc.docId = cols[0];
-            doc.authors = cols[2];
-            doc.title = cols[3];
-            doc.abstract = cols[4];
-            documents[doc.docId] = doc;
+            cerr << "Warning: Could not open index image at " << imagePath << endl;
         }
     }
+    auto mapMs = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - startTime).count() / 1000.0;
 
-    cout << "Loaded " << documents.size() << " documents" << endl;
+    installIndex(index);
+    cout << "Mapped " << source << " in " << mapMs << "ms: " << index->segmentCount() << " segment(s), "
+         << index->docCount() << " documents, Avg doc length: " << index->avgDocLength() << endl;
 }
 
-void loadDocUrls(const string &path)
+// Background thread: picks up segments committed by the indexer and
+// merges small segments, without blocking searches.
+void maintainSegments()
 {
-    ifstream file(path);
-    if (!file.is_open())
+    TieredMergePolicy policy;
+    while (true)
     {
-        cerr << "Warning: Could not open doc_urls at " << path << endl;
-        return;
-    }
+        this_thread::sleep_for(chrono::seconds(2));
 
-    string line;
-    getline(file, line); // Skip header
-
-    while (getline(file, line))
-    {
-        if (line.empty())
+        SegmentManifest manifest;
+        if (!loadManifest(segmentDir, manifest))
             continue;
 
-        size_t commaPos = line.find(',');
-        if (commaPos != string::npos)
+        auto current = currentIndex();
+        if (current->segmentCount() > 0 && manifest.generation == current->generation())
         {
-            string docId = line.substr(0, commaPos);
-            string url = line.substr(commaPos + 1);
-            docUrls[docId] = url;
+            // Nothing new: use the quiet time to merge
+            if (mergeSegments(segmentDir, policy) == 0)
+                continue;
         }
-    }
 
-    cout << "Loaded " << docUrls.size() << " document URLs" << endl;
+        auto index = make_shared<SegmentedIndex>();
+        if (!index->open(segmentDir))
+            continue; // mid-commit; try again next round
+
+        installIndex(index);
+        current.reset();
+        removeDeadSegments(segmentDir);
+        cout << "Now serving generation " << index->generation() << ": " << index->segmentCount()
+             << " segment(s), " << index->docCount() << " documents" << endl;
+    }
 }
 
 // ============================================
@@ -378,112 +375,190 @@ void loadDocUrls(const string &path)
 // and document length for relevance scoring
 // ============================================
 
-// Calculate IDF (Inverse Document Frequency) for a term
-double calculateIDF(int docFreq)
+// Results per page, and how deep pages may go: a page at offset needs
+// the top offset + k
+const size_t DEFAULT_RESULTS = 20;
+const size_t MAX_RESULTS = 100;
+const size_t MAX_RESULT_DEPTH = 1000;
+
+// BM25 candidates re-scored by term proximity. Always the same top
+// RERANK_DEPTH, so pages agree with each other however deep they go.
+const size_t RERANK_DEPTH = 200;
+
+double elapsedMs(chrono::high_resolution_clock::time_point since)
 {
-    if (docFreq <= 0 || totalDocuments <= 0)
-        return 0.0;
-    // Standard IDF formula with smoothing
-    return log((totalDocuments - docFreq + 0.5) / (docFreq + 0.5) + 1.0);
+    return chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - since).count() / 1000.0;
 }
 
-// Calculate BM25 score for a term in a document
-double calculateBM25Score(int termFreq, int docLength, double idf)
+// The distinct words of query in order, lowercased into loweredQuery;
+// words past MAX_QUERY_TERMS are dropped
+void uniqueQueryTerms(const string &query, string &loweredQuery, vector<string_view> &uniqueTerms)
 {
-    // BM25 formula
-    double tf = (double)termFreq;
-    double docLenNorm = (double)docLength / avgDocLength;
-    double numerator = tf * (k1 + 1);
-    double denominator = tf + k1 * (1 - b + b * docLenNorm);
-    return idf * (numerator / denominator);
+    vector<string_view> terms;
+    tokenizeWords(query, loweredQuery, terms);
+    uniqueTerms.clear();
+    for (string_view term : terms)
+        if (uniqueTerms.size() < MAX_QUERY_TERMS && find(uniqueTerms.begin(), uniqueTerms.end(), term) == uniqueTerms.end())
+            uniqueTerms.push_back(term);
 }
 
-vector<SearchResult> search(const string &query)
+// Two stages. First the BM25F top max(offset + k, RERANK_DEPTH), with
+// the title, abstract and body weighted by fieldWeights: a plain
+// list of words is scored a document at a time with Block-Max WAND
+// (retrieval.h), which skips the postings of docs that cannot reach
+// them, and the results equal scoring every posting. A query with AND,
+// OR, NOT, NEAR, parentheses or quotes (query_parser.h) returns only the
+// docs that satisfy it, ranked the same way; phrases and NEAR are
+// checked against the word positions in the index. Then the top
+// RERANK_DEPTH get a term proximity score from their positions
+// (rerankByProximity), so the cost of that stage does not grow with the
+// number of matches. Scoring only yields
+// (doc, score) pairs, and metadata is read for the k returned. The
+// caller passes the snapshot, so a reload between this and the spelling
+// suggestion cannot mix two indexes in one response.
+vector<SearchResult> search(const SegmentedIndex &index, const string &query, size_t offset,
+                            size_t k, const double *fieldWeights, SearchTiming &timing)
 {
-    vector<string> terms = tokenize(query);
-    unordered_map<string, double> scores;   // docId -> BM25 score
-    unordered_map<string, int> termMatches; // docId -> number of query terms matched
+    Bm25 bm25;
+    bm25.k1 = k1;
+    bm25.b = b;
+    bm25.docCount = index.docCount();
+    bm25.avgDocLength = index.avgDocLength();
+    for (int f = 0; f < SCORED_FIELDS; ++f)
+    {
+        bm25.fieldWeight[f] = fieldWeights[f];
+        // A field empty in every doc has no freqs to normalize
+        bm25.avgFieldLength[f] = index.avgFieldLength(f) > 0 ? index.avgFieldLength(f) : 1.0;
+    }
 
-    // Remove duplicate terms from query
-    unordered_set<string> uniqueTerms(terms.begin(), terms.end());
+    // Top offset + k (score, doc number), best first
+    offset = min(offset, MAX_RESULT_DEPTH);
+    k = min(k, MAX_RESULT_DEPTH - offset);
+    vector<ScoredDoc> ranked;
+    size_t depth = max(offset + k, RERANK_DEPTH);
 
-    // For each unique search term
-    for (const string &term : uniqueTerms)
+    auto start = chrono::high_resolution_clock::now();
+    string loweredQuery;
+    vector<string> words;
+    vector<string_view> terms;
+    QueryNode booleanQuery;
+    if (parseQuery(query, booleanQuery))
+    {
+        topKBoolean(index, booleanQuery, bm25, depth, ranked);
+        positiveWords(booleanQuery, words);
+        terms.assign(words.begin(), words.end());
+    }
+    else
     {
-        auto lexIt = lexicon.find(term);
-        if (lexIt == lexicon.end())
-            continue; // Word not in lexicon
+        uniqueQueryTerms(query, loweredQuery, terms);
+        topKBlockMaxWand(index, terms, bm25, depth, ranked);
+    }
+    timing.retrieveMs = elapsedMs(start);
 
-        int wordId = lexIt->second;
-        auto postIt = postings.find(wordId);
-        if (postIt == postings.end())
-            continue; // No postings
+    start = chrono::high_resolution_clock::now();
+    rerankByProximity(index, terms, bm25, RERANK_DEPTH, ranked);
+    timing.rerankMs = elapsedMs(start);
+    timing.reranked = terms.size() > 1 ? min(ranked.size(), RERANK_DEPTH) : 0;
 
-        // Get IDF for this term
-        double idf = calculateIDF(docFrequency[wordId]);
+    // Only the requested page is translated back to cord_id and metadata
+    start = chrono::high_resolution_clock::now();
+    vector<SearchResult> results;
+    for (size_t i = offset; i < min(ranked.size(), offset + k); i++)
+    {
+        const ScoredDoc &r = ranked[i];
+        uint32_t doc = r.doc;
 
-        // Calculate BM25 score for each document containing this term
-        for (const auto &posting : postIt->second)
+        SearchResult result;
+        result.docId = string(index.docField(doc, DOC_CORD_ID));
+        result.url = string(index.docField(doc, DOC_URL));
+        result.score = r.score;
+        result.title = string(index.docField(doc, DOC_TITLE));
+        result.authors = string(index.docField(doc, DOC_AUTHORS));
+        result.abstract = string(index.docField(doc, DOC_ABSTRACT));
+        if (result.title.empty())
         {
-            const string &docId = posting.first;
-            int termFreq = posting.second;
-            int docLength = docLengths.count(docId) ? docLengths[docId] : (int)avgDocLength;
-
-            double bm25Score = calculateBM25Score(termFreq, docLength, idf);
-            scores[docId] += bm25Score;
-            termMatches[docId]++;
+            result.title = "Document " + result.docId;
         }
+        results.push_back(result);
     }
+    timing.fetchMs = elapsedMs(start);
 
-    // Convert to vector and apply coordination factor boost
-    vector<SearchResult> results;
-    int queryTermCount = uniqueTerms.size();
+    return results;
+}
 
-    for (const auto &p : scores)
+// ============================================
+// "DID YOU MEAN"
+// ============================================
+// search() skips query terms that no segment has. Each such term is
+// looked up in the segments' spelling indexes (built with the images)
+// and replaced by the closest known word: fewest edits, at most 1 for
+// terms up to 4 letters and 2 for longer ones, then the highest df over
+// all segments. Returns the query with those terms replaced and the
+// rest kept as typed (boolean operators included), or "" if nothing
+// changed.
+string suggestCorrection(const SegmentedIndex &index, const string &query)
+{
+    string loweredQuery;
+    vector<string_view> terms;
+    tokenizeWords(query, loweredQuery, terms);
+
+    // Corrections are made in place, so operators, quotes and the rest
+    // of the text survive; loweredQuery lines up with query
+    string suggestion;
+    size_t copied = 0;
+    bool corrected = false;
+    vector<SpellingIndex::Match> matches;
+    string word;
+    for (string_view term : terms)
     {
-        SearchResult result;
-        result.docId = p.first;
-
-        // Apply coordination factor: documents matching more query terms get boosted
-        double coordFactor = queryTermCount > 0 ? (double)termMatches[p.first] / queryTermCount : 1.0;
-        result.score = p.second * (0.5 + 0.5 * coordFactor);
+        size_t start = term.data() - loweredQuery.data();
+        string_view original = string_view(query).substr(start, term.size());
+        if (original == "AND" || original == "OR" || original == "NOT" || original == "NEAR")
+            continue;
 
-        // Get document metadata if available
-        auto docIt = documents.find(p.first);
-        if (docIt != documents.end())
-        {
-            result.title = docIt->second.title;
-            result.authors = docIt->second.authors;
-            result.abstract = docIt->second.abstract;
-        }
-        else
-        {
-            result.title = "Document " + p.first;
-            result.authors = "";
-            result.abstract = "";
-        }
+        bool known = false;
+        for (size_t s = 0; s < index.segmentCount() && !known; s++)
+            known = index.segment(s).term(term) != nullptr;
 
-        // Get URL if available
-        auto urlIt = docUrls.find(p.first);
-        if (urlIt != docUrls.end())
+        string replacement(term);
+        if (!known && term.size() >= 3)
         {
-            result.url = urlIt->second;
+            uint32_t maxDistance = term.size() <= 4 ? 1 : 2;
+            uint32_t bestDistance = maxDistance + 1;
+            uint64_t bestDf = 0;
+            for (size_t s = 0; s < index.segmentCount(); s++)
+            {
+                const IndexImage &segment = index.segment(s);
+                matches.clear();
+                segment.spelling().lookup(term, maxDistance, segment.completions(), matches);
+                for (const SpellingIndex::Match &m : matches)
+                {
+                    if (segment.completions().weight(m.index) == 0)
+                        continue; // a lexicon word without postings
+                    segment.completions().word(m.index, word);
+                    uint64_t df = 0;
+                    for (size_t t = 0; t < index.segmentCount(); t++)
+                        df += index.segment(t).docFrequency(word);
+                    if (m.distance < bestDistance ||
+                        (m.distance == bestDistance && (df > bestDf || (df == bestDf && word < replacement))))
+                    {
+                        bestDistance = m.distance;
+                        bestDf = df;
+                        replacement = word;
+                    }
+                }
+            }
+            if (bestDistance <= maxDistance)
+            {
+                suggestion.append(query, copied, start - copied);
+                suggestion += replacement;
+                copied = start + term.size();
+                corrected = true;
+            }
         }
-
-        results.push_back(result);
     }
-
-    // Sort by score (highest first)
-    sort(results.begin(), results.end(), [](const SearchResult &a, const SearchResult &b)
-         { return a.score > b.score; });
-
-    // Return top 20 results
-    if (results.size() > 20)
-    {
-        results.resize(20);
-    }
-
-    return results;
+    suggestion.append(query, copied, string::npos);
+    return corrected ? suggestion : "";
 }
 
 // ============================================
@@ -519,7 +594,8 @@ string escapeJson(const string &s)
     return result;
 }
 
-string resultsToJson(const vector<SearchResult> &results)
+// suggestion is left out of the response when empty
+string resultsToJson(const vector<SearchResult> &results, const string &suggestion, const SearchTiming &timing)
 {
     stringstream json;
     json << "{\"results\":[";
@@ -538,7 +614,13 @@ string resultsToJson(const vector<SearchResult> &results)
         json << "}";
     }
 
-    json << "]}";
+    json << "]";
+    if (!suggestion.empty())
+        json << ",\"suggestion\":\"" << escapeJson(suggestion) << "\"";
+    json << ",\"timing\":{\"retrieveMs\":" << timing.retrieveMs << ",\"rerankMs\":" << timing.rerankMs
+         << ",\"fetchMs\":" << timing.fetchMs << ",\"suggestMs\":" << timing.suggestMs
+         << ",\"reranked\":" << timing.reranked << "}";
+    json << "}";
     return json.str();
 }
 
@@ -584,7 +666,7 @@ void handleClient(SOCKET clientSocket)
     else if (request.find("GET /autocomplete") != string::npos)
     {
         string prefix = getQueryParam(request);
-        auto suggestions = autocompleteTrie.autocomplete(prefix, 8);
+        vector<string> suggestions = autocomplete(*currentIndex(), prefix, 8);
         body = suggestionsToJson(suggestions);
 
         response = "HTTP/1.1 200 OK\r\n"
@@ -598,21 +680,33 @@ void handleClient(SOCKET clientSocket)
     else if (request.find("GET /search") != string::npos)
     {
         string query = getQueryParam(request);
+        size_t k = getCountParam(request, "k", DEFAULT_RESULTS, MAX_RESULTS);
+        size_t offset = getCountParam(request, "offset", 0, MAX_RESULT_DEPTH);
+        double fieldWeights[SCORED_FIELDS];
+        for (int f = 0; f < SCORED_FIELDS; ++f)
+            fieldWeights[f] = getWeightParam(request, FIELD_WEIGHT_PARAMS[f], Bm25().fieldWeight[f], MAX_FIELD_WEIGHT);
 
         // Measure search time
         auto startTime = chrono::high_resolution_clock::now();
 
-        auto results = search(query);
+        SearchTiming timing;
+        shared_ptr<const SegmentedIndex> index = currentIndex();
+        auto results = search(*index, query, offset, k, fieldWeights, timing);
+        auto suggestStart = chrono::high_resolution_clock::now();
+        string suggestion = suggestCorrection(*index, query);
+        timing.suggestMs = elapsedMs(suggestStart);
 
         auto searchEnd = chrono::high_resolution_clock::now();
         auto searchMs = chrono::duration_cast<chrono::microseconds>(searchEnd - startTime).count() / 1000.0;
 
-        body = resultsToJson(results);
+        body = resultsToJson(results, suggestion, timing);
 
         auto jsonEnd = chrono::high_resolution_clock::now();
         auto jsonMs = chrono::duration_cast<chrono::microseconds>(jsonEnd - searchEnd).count() / 1000.0;
 
-        cout << "Query: \"" << query << "\" | Search: " << searchMs << "ms | JSON: " << jsonMs << "ms | Results: " << results.size() << endl;
+        cout << "Query: \"" << query << "\" | Search: " << searchMs << "ms (retrieve " << timing.retrieveMs
+             << ", rerank " << timing.rerankMs << ", fetch " << timing.fetchMs << ", suggest " << timing.suggestMs
+             << ") | JSON: " << jsonMs << "ms | Results: " << results.size() << endl;
 
         response = "HTTP/1.1 200 OK\r\n"
                    "Content-Type: application/json\r\n" +
@@ -645,10 +739,8 @@ int main()
 
     // Load data
     cout << "\nLoading data..." << endl;
-    loadLexicon("data/lexicon.csv");
-    loadPostings("data/postings.csv");
-    loadDocuments("Code Produced Data/cord_processed.csv");
-    loadDocUrls("data/doc_urls.csv");
+    loadIndex("data/index.img");
+    thread(maintainSegments).detach();
 
 // Initialize Winsock (Windows only)
 #ifdef _WIN32
@@ -0,0 +1,62 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+Arena::Arena(size_t firstBlock) : minBlock(firstBlock ? firstBlock : 1)
+{
+}
+
+void Arena::grow(size_t bytes)
+{
+    size_t size = std::max(minBlock, bytes);
+    if (!blocks.empty())
+        size = std::max(size, blocks.back().size * 2);
+    blocks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+    used = 0;
+}
+
+void *Arena::allocate(size_t bytes, size_t align)
+{
+    if (!blocks.empty())
+    {
+        Block &b = blocks.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+        size_t start = ((base + used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+        if (start + bytes <= b.size)
+        {
+            used = start + bytes;
+            return b.data.get() + start;
+        }
+    }
+
+    // new[] returns memory aligned for any fundamental type
+    grow(bytes + align);
+    return allocate(bytes, align);
+}
+
+std::string_view Arena::copy(std::string_view s)
+{
+    char *p = static_cast<char *>(allocate(s.size(), 1));
+    std::memcpy(p, s.data(), s.size());
+    return std::string_view(p, s.size());
+}
+
+void Arena::reset()
+{
+    if (blocks.size() > 1)
+    {
+        size_t total = capacity();
+        blocks.clear();
+        grow(total);
+    }
+    used = 0;
+}
+
+size_t Arena::capacity() const
+{
+    size_t total = 0;
+    for (auto &b : blocks)
+        total += b.size;
+    return total;
+}
@@ -0,0 +1,53 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator for per-document data. Memory is handed out from large
+// blocks and released all at once by reset(). A reset also folds every
+// block into a single one as large as their total, so once the arena
+// has seen its largest document it no longer touches the heap.
+// Objects placed in the arena are never destroyed; use it for trivially
+// destructible data only.
+class Arena
+{
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+    };
+
+    std::vector<Block> blocks; // the last one is being filled
+    size_t used = 0;           // bytes used in blocks.back()
+    size_t minBlock;
+
+    void grow(size_t bytes);
+
+public:
+    explicit Arena(size_t firstBlock = 64 << 10);
+
+    Arena(Arena &&) = default;
+    Arena &operator=(Arena &&) = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+    template <typename T>
+    T *allocateArray(size_t n)
+    {
+        return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Copies s into the arena; the view stays valid until reset().
+    std::string_view copy(std::string_view s);
+
+    void reset();
+    size_t capacity() const;
+};
+
+#endif
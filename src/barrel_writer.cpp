@@ -0,0 +1,97 @@
+#include "barrel_writer.h"
+#include <charconv>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+void appendInt(std::string &out, int v)
+{
+    char digits[16];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), v).ptr);
+}
+} // namespace
+
+BarrelWriterPool::BarrelWriterPool(const std::string &barrelDir,
+                                   const std::string &hitlistDir,
+                                   size_t flushBytes)
+    : barrelDir(barrelDir), hitlistDir(hitlistDir), flushBytes(flushBytes)
+{
+    fs::create_directories(barrelDir);
+    fs::create_directories(hitlistDir);
+}
+
+BarrelWriterPool::~BarrelWriterPool()
+{
+    flush();
+}
+
+BarrelWriterPool::Barrel &BarrelWriterPool::open(int barrelID)
+{
+    if (barrelID >= (int)barrels.size())
+        barrels.resize(barrelID + 1);
+
+    auto &slot = barrels[barrelID];
+    if (!slot)
+    {
+        slot = std::make_unique<Barrel>();
+        std::string id = std::to_string(barrelID);
+        slot->barrelOut.open(barrelDir + "/barrel_" + id + ".csv", std::ios::app | std::ios::binary);
+        slot->hitlistOut.open(hitlistDir + "/hitlist_" + id + ".csv", std::ios::app | std::ios::binary);
+        slot->barrelBuf.reserve(flushBytes);
+        slot->hitlistBuf.reserve(flushBytes);
+    }
+    return *slot;
+}
+
+void BarrelWriterPool::write(int wordID,
+                             const std::string &docID,
+                             int freq,
+                             int priority,
+                             const int *positions,
+                             size_t positionCount)
+{
+    Barrel &b = open(barrelID(wordID));
+
+    size_t prefixStart = b.barrelBuf.size();
+    appendInt(b.barrelBuf, wordID);
+    b.barrelBuf += ',';
+    b.barrelBuf += docID;
+    b.barrelBuf += ',';
+    appendInt(b.barrelBuf, freq);
+
+    b.hitlistBuf.append(b.barrelBuf, prefixStart, std::string::npos);
+    b.barrelBuf += '\n';
+
+    b.hitlistBuf += ',';
+    appendInt(b.hitlistBuf, priority);
+    b.hitlistBuf += ',';
+    for (size_t i = 0; i < positionCount; ++i)
+    {
+        if (i)
+            b.hitlistBuf += '|';
+        appendInt(b.hitlistBuf, positions[i]);
+    }
+    b.hitlistBuf += '\n';
+
+    if (b.barrelBuf.size() + b.hitlistBuf.size() >= flushBytes)
+        flushBarrel(b);
+}
+
+void BarrelWriterPool::flushBarrel(Barrel &b)
+{
+    b.barrelOut.write(b.barrelBuf.data(), b.barrelBuf.size());
+    b.hitlistOut.write(b.hitlistBuf.data(), b.hitlistBuf.size());
+    b.barrelBuf.clear();
+    b.hitlistBuf.clear();
+    b.barrelOut.flush();
+    b.hitlistOut.flush();
+}
+
+void BarrelWriterPool::flush()
+{
+    for (auto &b : barrels)
+        if (b)
+            flushBarrel(*b);
+}
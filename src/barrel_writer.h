@@ -0,0 +1,57 @@
+#ifndef BARREL_WRITER_H
+#define BARREL_WRITER_H
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+const int BARREL_SIZE = 1000; // words per barrel
+
+// Keeps one barrel file and one hitlist file open per barrel for the
+// whole indexing run. Rows are appended to an in-memory buffer and only
+// written out once the buffer reaches flushBytes (or on flush()).
+class BarrelWriterPool
+{
+private:
+    struct Barrel
+    {
+        std::ofstream barrelOut;
+        std::ofstream hitlistOut;
+        std::string barrelBuf;
+        std::string hitlistBuf;
+    };
+
+    std::string barrelDir;
+    std::string hitlistDir;
+    size_t flushBytes;
+    std::vector<std::unique_ptr<Barrel>> barrels; // indexed by barrel ID
+
+    Barrel &open(int barrelID);
+    void flushBarrel(Barrel &b);
+
+public:
+    explicit BarrelWriterPool(const std::string &barrelDir = "data/barrels",
+                              const std::string &hitlistDir = "data/hitlists",
+                              size_t flushBytes = 1 << 20);
+    ~BarrelWriterPool();
+
+    BarrelWriterPool(const BarrelWriterPool &) = delete;
+    BarrelWriterPool &operator=(const BarrelWriterPool &) = delete;
+
+    static int barrelID(int wordID) { return wordID / BARREL_SIZE; }
+
+    // Rows are formatted straight into the barrel buffers.
+    // barrel:  wordID,docID,freq
+    // hitlist: wordID,docID,freq,priority,pos1|pos2|...
+    void write(int wordID,
+               const std::string &docID,
+               int freq,
+               int priority,
+               const int *positions,
+               size_t positionCount);
+
+    void flush();
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "body_text_extractor.h"
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+// Cursor over the raw JSON. Every function leaves p after what it
+// consumed and returns false on malformed input.
+struct Scanner
+{
+    const char *p;
+    const char *end;
+
+    void skipSpace()
+    {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+            ++p;
+    }
+
+    bool expect(char c)
+    {
+        skipSpace();
+        if (p == end || *p != c)
+            return false;
+        ++p;
+        return true;
+    }
+
+    // After the opening quote: jump from quote/backslash to quote/backslash.
+    bool skipString()
+    {
+        while (true)
+        {
+            const char *q = static_cast<const char *>(std::memchr(p, '"', end - p));
+            if (!q)
+                return false;
+            // The quote is escaped iff an odd number of backslashes precede it
+            const char *b = q;
+            while (b > p && b[-1] == '\\')
+                --b;
+            p = q + 1;
+            if ((q - b) % 2 == 0)
+                return true;
+        }
+    }
+
+    static void appendUtf8(std::string &out, uint32_t cp)
+    {
+        if (cp < 0x80)
+            out += (char)cp;
+        else if (cp < 0x800)
+        {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool readHex4(uint32_t &v)
+    {
+        if (end - p < 4)
+            return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            char c = *p++;
+            v <<= 4;
+            if (c >= '0' && c <= '9')
+                v |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                v |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                v |= c - 'A' + 10;
+            else
+                return false;
+        }
+        return true;
+    }
+
+    // After the opening quote: appends the unescaped string to out.
+    bool readString(std::string &out)
+    {
+        while (true)
+        {
+            // Copy the run up to the next quote or backslash in one go
+            const char *q = p;
+            while (q < end && *q != '"' && *q != '\\')
+                ++q;
+            out.append(p, q - p);
+            p = q;
+            if (p == end)
+                return false;
+            if (*p++ == '"')
+                return true;
+
+            if (p == end)
+                return false;
+            char e = *p++;
+            switch (e)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                out += e;
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u':
+            {
+                uint32_t cp;
+                if (!readHex4(cp))
+                    return false;
+                // Surrogate pair
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+                {
+                    const char *save = p;
+                    p += 2;
+                    uint32_t low;
+                    if (readHex4(low) && low >= 0xDC00 && low < 0xE000)
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    else
+                        p = save;
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+    }
+
+    // Skips one value of any type, including nested objects and arrays.
+    bool skipValue()
+    {
+        skipSpace();
+        if (p == end)
+            return false;
+
+        if (*p == '"')
+        {
+            ++p;
+            return skipString();
+        }
+        if (*p == '{' || *p == '[')
+        {
+            int depth = 0;
+            while (p < end)
+            {
+                char c = *p++;
+                if (c == '"')
+                {
+                    if (!skipString())
+                        return false;
+                }
+                else if (c == '{' || c == '[')
+                    ++depth;
+                else if (c == '}' || c == ']')
+                {
+                    if (--depth == 0)
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        // number, true, false, null
+        const char *start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' &&
+               *p != '\n' && *p != '\r' && *p != '\t')
+            ++p;
+        return p > start;
+    }
+
+    // Reads an object key (into key, reused) and the colon after it.
+    bool readKey(std::string &key)
+    {
+        if (!expect('"'))
+            return false;
+        key.clear();
+        return readString(key) && expect(':');
+    }
+
+    // After '{' or '[': true if another member follows, false at the
+    // closing bracket (ok set to false on malformed input).
+    bool nextMember(bool first, char close, bool &ok)
+    {
+        skipSpace();
+        if (p < end && *p == close)
+        {
+            ++p;
+            return false;
+        }
+        if (!first && !expect(','))
+        {
+            ok = false;
+            return false;
+        }
+        return true;
+    }
+};
+} // namespace
+
+bool BodyTextExtractor::parse(const char *data, size_t size)
+{
+    chars.clear();
+    paragraphs.clear();
+
+    Scanner s{data, data + size};
+    std::string key;
+    bool ok = true;
+
+    if (!s.expect('{'))
+        return false;
+    for (bool first = true; s.nextMember(first, '}', ok); first = false)
+    {
+        if (!s.readKey(key))
+            return false;
+        if (key != "body_text")
+        {
+            if (!s.skipValue())
+                return false;
+            continue;
+        }
+
+        if (!s.expect('['))
+            return false;
+        for (bool firstPara = true; s.nextMember(firstPara, ']', ok); firstPara = false)
+        {
+            if (!s.expect('{'))
+                return false;
+
+            Paragraph para{0, 0, 0, 0};
+            for (bool firstField = true; s.nextMember(firstField, '}', ok); firstField = false)
+            {
+                if (!s.readKey(key))
+                    return false;
+
+                bool isText = key == "text";
+                bool isSection = key == "section";
+                s.skipSpace();
+                if ((isText || isSection) && s.p < s.end && *s.p == '"')
+                {
+                    ++s.p;
+                    uint32_t begin = (uint32_t)chars.size();
+                    if (!s.readString(chars))
+                        return false;
+                    uint32_t length = (uint32_t)chars.size() - begin;
+                    if (isText)
+                        para.textBegin = begin, para.textLength = length;
+                    else
+                        para.sectionBegin = begin, para.sectionLength = length;
+                }
+                else if (!s.skipValue())
+                    return false;
+            }
+            if (!ok)
+                return false;
+            paragraphs.push_back(para);
+        }
+        if (!ok)
+            return false;
+    }
+    return ok;
+}
+
+bool BodyTextExtractor::parseFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open())
+    {
+        chars.clear();
+        paragraphs.clear();
+        return false;
+    }
+    fileBuffer.resize((size_t)in.tellg());
+    in.seekg(0);
+    in.read(&fileBuffer[0], fileBuffer.size());
+    return parse(fileBuffer.data(), fileBuffer.size());
+}
+
+void BodyTextExtractor::appendBody(std::string &out) const
+{
+    std::string_view lastSection;
+    for (size_t i = 0; i < paragraphs.size(); ++i)
+    {
+        std::string_view sec = section(i);
+        if (!sec.empty() && sec != lastSection)
+        {
+            out.append(sec.data(), sec.size());
+            out += ' ';
+            lastSection = sec;
+        }
+        std::string_view t = text(i);
+        out.append(t.data(), t.size());
+        out += ' ';
+    }
+}
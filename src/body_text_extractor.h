@@ -0,0 +1,49 @@
+#ifndef BODY_TEXT_EXTRACTOR_H
+#define BODY_TEXT_EXTRACTOR_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Pulls body_text[].text and body_text[].section out of a CORD-19
+// document parse (pmc_json / pdf_json) in one forward scan of the raw
+// bytes. Everything else (metadata, cite_spans, bib_entries, ...) is
+// skipped without being decoded. Strings are unescaped into a buffer
+// owned by the extractor and reused for the next document, so a
+// long-lived extractor stops allocating after the first few files.
+class BodyTextExtractor
+{
+private:
+    struct Paragraph
+    {
+        uint32_t sectionBegin, sectionLength;
+        uint32_t textBegin, textLength;
+    };
+
+    std::string fileBuffer;
+    std::string chars; // unescaped section names and texts
+    std::vector<Paragraph> paragraphs;
+
+public:
+    // Returns false if the input is not well-formed JSON; paragraphs
+    // found before the error are kept.
+    bool parse(const char *data, size_t size);
+    bool parseFile(const std::string &path);
+
+    size_t paragraphCount() const { return paragraphs.size(); }
+    std::string_view section(size_t i) const
+    {
+        return std::string_view(chars.data() + paragraphs[i].sectionBegin, paragraphs[i].sectionLength);
+    }
+    std::string_view text(size_t i) const
+    {
+        return std::string_view(chars.data() + paragraphs[i].textBegin, paragraphs[i].textLength);
+    }
+
+    // Appends the body as plain text: each section name where the
+    // section changes, then its paragraphs, separated by spaces.
+    void appendBody(std::string &out) const;
+};
+
+#endif
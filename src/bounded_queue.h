@@ -0,0 +1,91 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// Fixed-capacity blocking queue connecting two pipeline stages.
+// push() waits while the queue is full, pop() waits while it is empty.
+// Once close() is called, pop() drains what is left and then returns
+// false. Items live in a ring of capacity slots allocated up front, so
+// passing an item through does not allocate; a slot keeps the
+// moved-from item until it is reused.
+template <typename T>
+class BoundedQueue
+{
+private:
+    std::vector<T> slots;
+    size_t head = 0; // next slot to pop
+    size_t count = 0;
+    bool closed = false;
+    std::mutex m;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+    void pushLocked(T &item)
+    {
+        slots[(head + count) % slots.size()] = std::move(item);
+        ++count;
+        notEmpty.notify_one();
+    }
+
+    void popLocked(T &out)
+    {
+        out = std::move(slots[head]);
+        head = (head + 1) % slots.size();
+        --count;
+        notFull.notify_one();
+    }
+
+public:
+    explicit BoundedQueue(size_t capacity) : slots(capacity ? capacity : 1) {}
+
+    void push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m);
+        notFull.wait(lock, [&] { return count < slots.size() || closed; });
+        if (closed)
+            return;
+        pushLocked(item);
+    }
+
+    bool pop(T &out)
+    {
+        std::unique_lock<std::mutex> lock(m);
+        notEmpty.wait(lock, [&] { return count > 0 || closed; });
+        if (count == 0)
+            return false;
+        popLocked(out);
+        return true;
+    }
+
+    // Non-blocking versions: return false instead of waiting.
+    bool tryPush(T &item)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (count == slots.size() || closed)
+            return false;
+        pushLocked(item);
+        return true;
+    }
+
+    bool tryPop(T &out)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (count == 0)
+            return false;
+        popLocked(out);
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+};
+
+#endif
@@ -0,0 +1,321 @@
+// Packs the index into data/index.img for the search server: lexicon.csv,
+// postings.bin, doc_table.csv, the word positions in data/hitlists and
+// the titles/authors/abstracts from cord_processed.csv. Run it after
+// convert_postings. The title and abstract are tokenized again for their
+// lengths, and the body is the rest of the doc's length; postings.bin
+// only has each posting's best field, so a posting counts one
+// occurrence there and the rest in the body. With --segments the
+// image is committed as a new segment instead, e.g. to seed
+// data/segments from an existing index before indexing incrementally.
+
+#include "index_image.h"
+#include "barrel_writer.h"
+#include "doc_table.h"
+#include "segments.h"
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+// Splits a CSV line into fields, respecting quoted commas.
+std::vector<std::string> splitCSVLine(const std::string &line)
+{
+    std::vector<std::string> cols;
+    std::string cur;
+    bool inQuotes = false;
+    for (char c : line)
+    {
+        if (c == '"')
+            inQuotes = !inQuotes;
+        else if (c == ',' && !inQuotes)
+        {
+            cols.push_back(cur);
+            cur.clear();
+        }
+        else
+            cur.push_back(c);
+    }
+    cols.push_back(cur);
+    return cols;
+}
+
+// Word positions from the indexer's hitlists, rows of
+// wordID,docID,freq,priority,pos1|pos2|... with one file per barrel of
+// wordIDs. writeIndexImage asks in wordID order, so one barrel is held
+// at a time. Older indexers appended a row per occurrence with the
+// positions so far: the longest row of a word in a doc is kept, sorted.
+// They also numbered each field from 0 and did not record which field
+// a position is in, so those positions cannot be put on one axis. A
+// doc's positions are only used if, over all its words, they are
+// exactly 0 to its length - 1 once each; other docs get none, and
+// phrases are matched in them as ANDs.
+class HitlistPositions
+{
+private:
+    using Rows = std::unordered_map<uint64_t, std::vector<uint32_t>>; // by wordID << 32 | doc
+
+    std::string dir;
+    const std::unordered_map<std::string, size_t> &docNumbers;
+    std::vector<bool> oneAxis; // by doc
+    int barrel = -1;
+    Rows positions;
+
+    static uint64_t key(int wordID, uint32_t doc) { return (uint64_t)(uint32_t)wordID << 32 | doc; }
+
+    void read(const std::string &path, Rows &rows) const
+    {
+        rows.clear();
+        std::ifstream in(path);
+        std::string line;
+        std::vector<uint32_t> row;
+        while (getline(in, line))
+        {
+            size_t c1 = line.find(','), c2 = line.find(',', c1 + 1);
+            size_t c3 = line.find(',', c2 + 1), c4 = line.find(',', c3 + 1);
+            if (c4 == std::string::npos)
+                continue;
+            auto doc = docNumbers.find(line.substr(c1 + 1, c2 - c1 - 1));
+            if (doc == docNumbers.end())
+                continue; // not in this index
+            row.clear();
+            for (size_t p = c4 + 1; p < line.size();)
+            {
+                size_t end = line.find('|', p);
+                if (end == std::string::npos)
+                    end = line.size();
+                row.push_back((uint32_t)std::strtoul(line.c_str() + p, nullptr, 10));
+                p = end + 1;
+            }
+            std::vector<uint32_t> &kept = rows[key(std::atoi(line.c_str()), (uint32_t)doc->second)];
+            if (row.size() > kept.size())
+                kept = row;
+        }
+        for (auto &r : rows)
+        {
+            std::sort(r.second.begin(), r.second.end());
+            r.second.erase(std::unique(r.second.begin(), r.second.end()), r.second.end());
+        }
+    }
+
+public:
+    size_t found = 0; // postings that had positions
+
+    // A first pass over every barrel marks which positions each doc has
+    HitlistPositions(const std::string &dir, const std::unordered_map<std::string, size_t> &docNumbers,
+                     const std::vector<ImageDoc> &docs)
+        : dir(dir), docNumbers(docNumbers), oneAxis(docs.size(), true)
+    {
+        std::vector<std::vector<bool>> seen(docs.size());
+        for (size_t d = 0; d < docs.size(); ++d)
+            seen[d].assign(docs[d].length, false);
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(dir, ec))
+        {
+            read(entry.path().string(), positions);
+            for (const auto &r : positions)
+            {
+                uint32_t doc = (uint32_t)r.first;
+                if (doc >= docs.size())
+                    continue;
+                for (uint32_t p : r.second)
+                {
+                    // Past the end, or a second word at the same position
+                    if (p >= seen[doc].size() || seen[doc][p])
+                        oneAxis[doc] = false;
+                    else
+                        seen[doc][p] = true;
+                }
+            }
+        }
+        positions.clear();
+        for (size_t d = 0; d < docs.size(); ++d)
+            oneAxis[d] = oneAxis[d] && !seen[d].empty() &&
+                         std::find(seen[d].begin(), seen[d].end(), false) == seen[d].end();
+    }
+
+    size_t docsWithPositions() const { return (size_t)std::count(oneAxis.begin(), oneAxis.end(), true); }
+
+    bool get(int wordID, uint32_t doc, std::vector<uint32_t> &out)
+    {
+        if (doc >= oneAxis.size() || !oneAxis[doc])
+            return false;
+        if (BarrelWriterPool::barrelID(wordID) != barrel)
+        {
+            barrel = BarrelWriterPool::barrelID(wordID);
+            read(dir + "/hitlist_" + std::to_string(barrel) + ".csv", positions);
+        }
+        auto it = positions.find(key(wordID, doc));
+        if (it == positions.end())
+            return false;
+        out = it->second;
+        ++found;
+        return true;
+    }
+};
+} // namespace
+
+// Usage: build_index_image [--lexicon path] [--postings path] [--doc-table path]
+//                          [--hitlists dir] [--documents path] [--out path]
+//                          [--segments dir]
+int main(int argc, char **argv)
+{
+    std::string lexiconPath = "data/lexicon.csv";
+    std::string postingsPath = "data/postings.bin";
+    std::string docTablePath = "data/doc_table.csv";
+    std::string hitlistDir = "data/hitlists";
+    std::string documentsPath = "Code Produced Data/cord_processed.csv";
+    std::string outPath = "data/index.img";
+    std::string segmentDir;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        if (flag == "--lexicon")
+            lexiconPath = argv[i + 1];
+        else if (flag == "--postings")
+            postingsPath = argv[i + 1];
+        else if (flag == "--doc-table")
+            docTablePath = argv[i + 1];
+        else if (flag == "--hitlists")
+            hitlistDir = argv[i + 1];
+        else if (flag == "--documents")
+            documentsPath = argv[i + 1];
+        else if (flag == "--out")
+            outPath = argv[i + 1];
+        else if (flag == "--segments")
+            segmentDir = argv[i + 1];
+        else
+        {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::pair<std::string, int>> lexicon;
+    std::ifstream lex(lexiconPath);
+    if (!lex.is_open())
+    {
+        std::cerr << "Cannot open " << lexiconPath << "\n";
+        return 1;
+    }
+    std::string line;
+    std::unordered_set<std::string> seen;
+    size_t duplicates = 0;
+    getline(lex, line); // header
+    while (getline(lex, line))
+    {
+        size_t comma = line.rfind(','); // words may contain commas
+        if (comma == std::string::npos)
+            continue;
+        // The image holds one wordID per word; a repeated row keeps the first
+        std::string word = line.substr(0, comma);
+        if (!seen.insert(word).second)
+        {
+            ++duplicates;
+            continue;
+        }
+        lexicon.emplace_back(std::move(word), std::stoi(line.substr(comma + 1)));
+    }
+    if (duplicates > 0)
+        std::cerr << "Warning: skipped " << duplicates << " repeated words in " << lexiconPath << "\n";
+
+    std::ifstream post(postingsPath, std::ios::binary | std::ios::ate);
+    if (!post.is_open())
+    {
+        std::cerr << "Cannot open " << postingsPath << "\n";
+        return 1;
+    }
+    std::vector<uint8_t> postingsFile((size_t)post.tellg());
+    post.seekg(0);
+    post.read(reinterpret_cast<char *>(postingsFile.data()), postingsFile.size());
+
+    PostingsReader check;
+    if (!check.attach(postingsFile.data(), postingsFile.size()))
+    {
+        std::cerr << postingsPath << " is not a postings file\n";
+        return 1;
+    }
+
+    std::vector<DocInfo> docTable;
+    if (!loadDocTable(docTablePath, docTable))
+    {
+        std::cerr << "Cannot open " << docTablePath << "\n";
+        return 1;
+    }
+    if (docTable.size() != check.docCount())
+        std::cerr << "Warning: postings list " << check.docCount() << " docs but doc table has "
+                  << docTable.size() << "\n";
+
+    std::vector<ImageDoc> docs(docTable.size());
+    std::unordered_map<std::string, size_t> docNumbers;
+    for (size_t i = 0; i < docTable.size(); ++i)
+    {
+        docs[i].fields[DOC_CORD_ID] = docTable[i].cordID;
+        docs[i].fields[DOC_URL] = docTable[i].url;
+        docs[i].length = docTable[i].length;
+        docNumbers[docTable[i].cordID] = i;
+    }
+
+    // cord_id,url,authors,title,abstract,...
+    size_t described = 0;
+    std::string lowered;
+    std::vector<std::string_view> words;
+    std::ifstream documents(documentsPath);
+    if (!documents.is_open())
+        std::cerr << "Warning: Could not open documents at " << documentsPath << "\n";
+    else
+    {
+        getline(documents, line); // header
+        while (getline(documents, line))
+        {
+            auto cols = splitCSVLine(line);
+            if (cols.size() < 5)
+                continue;
+            auto it = docNumbers.find(cols[0]);
+            if (it == docNumbers.end())
+                continue;
+            ImageDoc &d = docs[it->second];
+            d.fields[DOC_AUTHORS] = cols[2];
+            d.fields[DOC_TITLE] = cols[3];
+            d.fields[DOC_ABSTRACT] = cols[4];
+            tokenizeWords(cols[3], lowered, words);
+            d.fieldLengths[FIELD_TITLE] = (uint32_t)words.size();
+            tokenizeWords(cols[4], lowered, words);
+            d.fieldLengths[FIELD_ABSTRACT] = (uint32_t)words.size();
+            uint32_t heading = d.fieldLengths[FIELD_TITLE] + d.fieldLengths[FIELD_ABSTRACT];
+            d.fieldLengths[FIELD_BODY] = d.length - std::min(d.length, heading);
+            ++described;
+        }
+    }
+
+    if (!segmentDir.empty())
+        outPath = newSegmentPath(segmentDir);
+    HitlistPositions hitlists(hitlistDir, docNumbers, docs);
+    if (!writeIndexImage(outPath, lexicon, postingsFile, docs,
+                         [&](int wordID, uint32_t doc, std::vector<uint32_t> &out)
+                         { return hitlists.get(wordID, doc, out); }))
+    {
+        std::cerr << "Cannot write " << outPath << "\n";
+        return 1;
+    }
+    if (!segmentDir.empty() && !commitSegment(segmentDir, outPath, (uint32_t)docs.size()))
+    {
+        std::cerr << "Cannot commit segment to " << segmentDir << "\n";
+        return 1;
+    }
+
+    std::cout << "Wrote " << outPath << ": " << lexicon.size() << " words, "
+              << check.termCount() << " posting lists, " << docs.size() << " docs ("
+              << described << " with title/abstract), positions for " << hitlists.found << " postings in "
+              << hitlists.docsWithPositions() << " docs\n";
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Converts an existing data/postings.csv into data/postings.bin without
+// re-indexing. Older indexers listed a doc once per occurrence with a
+// running freq, so repeated docIDs within a word are folded into one
+// posting (largest freq, best field). A doc table for the same doc
+// numbers is written alongside, with URLs taken from doc_urls.csv.
+
+#include "postings_format.h"
+#include "doc_table.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Usage: convert_postings [--in path] [--out path] [--codec vbyte|bitpack]
+//                         [--doc-urls path] [--doc-table path]
+int main(int argc, char **argv)
+{
+    std::string inPath = "data/postings.csv";
+    std::string outPath = "data/postings.bin";
+    std::string docUrlsPath = "data/doc_urls.csv";
+    std::string docTablePath = "data/doc_table.csv";
+    PostingsCodec codec = PostingsCodec::VByte;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        if (flag == "--in")
+            inPath = argv[i + 1];
+        else if (flag == "--out")
+            outPath = argv[i + 1];
+        else if (flag == "--codec")
+            codec = std::string(argv[i + 1]) == "bitpack" ? PostingsCodec::BitPacked
+                                                          : PostingsCodec::VByte;
+        else if (flag == "--doc-urls")
+            docUrlsPath = argv[i + 1];
+        else if (flag == "--doc-table")
+            docTablePath = argv[i + 1];
+        else
+        {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    std::ifstream in(inPath);
+    if (!in.is_open())
+    {
+        std::cerr << "Cannot open " << inPath << "\n";
+        return 1;
+    }
+
+    std::unordered_map<std::string, uint32_t> docNumbers;
+    std::vector<std::string> docIDs;
+    std::vector<std::pair<int, PostingList>> lists;
+    long long postings = 0;
+
+    std::string line;
+    getline(in, line); // header
+    while (getline(in, line))
+    {
+        if (line.empty())
+            continue;
+
+        std::stringstream ss(line);
+        std::string wid, docs, freqs, prios;
+        getline(ss, wid, ',');
+        getline(ss, docs, ',');
+        getline(ss, freqs, ',');
+        getline(ss, prios, ',');
+
+        std::stringstream dss(docs), fss(freqs), pss(prios);
+        std::string d, f, p;
+        std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> merged; // doc -> (freq, field)
+        while (getline(dss, d, ';') && getline(fss, f, ';'))
+        {
+            if (!getline(pss, p, ';'))
+                p = "3";
+
+            auto it = docNumbers.find(d);
+            if (it == docNumbers.end())
+            {
+                it = docNumbers.emplace(d, (uint32_t)docIDs.size()).first;
+                docIDs.push_back(d);
+            }
+
+            uint32_t freq = (uint32_t)std::stoul(f);
+            uint32_t field = (uint32_t)std::stoul(p);
+            auto m = merged.find(it->second);
+            if (m == merged.end())
+                merged.emplace(it->second, std::make_pair(freq, field));
+            else
+            {
+                m->second.first = std::max(m->second.first, freq);
+                m->second.second = std::min(m->second.second, field);
+            }
+        }
+
+        std::vector<uint32_t> order;
+        for (auto &m : merged)
+            order.push_back(m.first);
+        std::sort(order.begin(), order.end());
+
+        PostingList list;
+        for (uint32_t doc : order)
+        {
+            list.docs.push_back(doc);
+            list.freqs.push_back(merged[doc].first);
+            list.fields.push_back(merged[doc].second);
+        }
+        postings += list.docs.size();
+        lists.emplace_back(std::stoi(wid), std::move(list));
+    }
+
+    std::sort(lists.begin(), lists.end(), [](const auto &a, const auto &b)
+              { return a.first < b.first; });
+
+    PostingsWriter writer(outPath, codec);
+    if (!writer.isOpen())
+    {
+        std::cerr << "Cannot write " << outPath << "\n";
+        return 1;
+    }
+    for (auto &l : lists)
+        writer.addTerm(l.first, l.second);
+    writer.finish(docIDs);
+
+    // Doc table: lengths are the sum of a doc's freqs over all words
+    std::vector<DocInfo> docTable(docIDs.size());
+    for (size_t i = 0; i < docIDs.size(); ++i)
+        docTable[i].cordID = docIDs[i];
+    for (auto &l : lists)
+        for (size_t i = 0; i < l.second.docs.size(); ++i)
+            docTable[l.second.docs[i]].length += l.second.freqs[i];
+
+    std::ifstream urls(docUrlsPath);
+    if (urls.is_open())
+    {
+        getline(urls, line); // header
+        while (getline(urls, line))
+        {
+            size_t comma = line.find(',');
+            if (comma == std::string::npos)
+                continue;
+            auto it = docNumbers.find(line.substr(0, comma));
+            if (it != docNumbers.end())
+                docTable[it->second].url = line.substr(comma + 1);
+        }
+    }
+    if (!saveDocTable(docTablePath, docTable))
+        std::cerr << "Cannot write " << docTablePath << "\n";
+
+    // Size report: the data section is what grows with the corpus
+    PostingsReader check;
+    uint64_t dataBytes = 0;
+    if (check.load(outPath))
+        for (size_t i = 0; i < check.termCount(); ++i)
+            dataBytes += (uint64_t)check.entry(i).docBytes + check.entry(i).freqBytes + check.entry(i).fieldBytes;
+
+    std::cout << "Wrote " << lists.size() << " terms, " << postings << " postings, "
+              << docIDs.size() << " docs to " << outPath << "\n";
+    if (postings > 0)
+        std::cout << "CSV: " << fs::file_size(inPath) << " bytes ("
+                  << (double)fs::file_size(inPath) / postings << " per posting), binary: "
+                  << fs::file_size(outPath) << " bytes, postings data "
+                  << (double)dataBytes / postings << " bytes per posting\n";
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "doc_table.h"
+#include <fstream>
+
+bool saveDocTable(const std::string &path, const std::vector<DocInfo> &docs)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+        return false;
+
+    out << "docNum,cord_id,length,url\n";
+    for (size_t i = 0; i < docs.size(); ++i)
+        out << i << "," << docs[i].cordID << "," << docs[i].length << "," << docs[i].url << "\n";
+    return true;
+}
+
+bool loadDocTable(const std::string &path, std::vector<DocInfo> &docs)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+        return false;
+
+    docs.clear();
+    std::string line;
+    getline(in, line); // header
+    while (getline(in, line))
+    {
+        if (line.empty())
+            continue;
+
+        // url is last and may itself contain commas
+        size_t c1 = line.find(',');
+        size_t c2 = line.find(',', c1 + 1);
+        size_t c3 = line.find(',', c2 + 1);
+        if (c1 == std::string::npos || c2 == std::string::npos || c3 == std::string::npos)
+            continue;
+
+        size_t docNum = std::stoul(line.substr(0, c1));
+        if (docNum >= docs.size())
+            docs.resize(docNum + 1);
+
+        DocInfo &d = docs[docNum];
+        d.cordID = line.substr(c1 + 1, c2 - c1 - 1);
+        d.length = (uint32_t)std::stoul(line.substr(c2 + 1, c3 - c2 - 1));
+        d.url = line.substr(c3 + 1);
+    }
+    return true;
+}
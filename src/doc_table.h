@@ -0,0 +1,20 @@
+#ifndef DOC_TABLE_H
+#define DOC_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One row per dense doc number, the same numbers used in postings.bin.
+// Stored as data/doc_table.csv: docNum,cord_id,length,url
+struct DocInfo
+{
+    std::string cordID;
+    std::string url;
+    uint32_t length = 0; // total tokens, for BM25 length normalization
+};
+
+bool saveDocTable(const std::string &path, const std::vector<DocInfo> &docs);
+bool loadDocTable(const std::string &path, std::vector<DocInfo> &docs);
+
+#endif
@@ -1,21 +1,25 @@
 #include "forward_index.h"
+#include <charconv>
 #include <fstream>
 
 void writeForwardIndex(
     const std::string &docID,
-    const std::unordered_set<int> &wordSet)
+    const std::vector<int> &wordIDs)
 {
-    std::ofstream out("data/forward_index.csv", std::ios::app);
-    out << docID << ",";
+    static std::ofstream out("data/forward_index.csv", std::ios::app | std::ios::binary);
+    static std::string row; // reused, so steady-state rows do not allocate
 
-    bool first = true;
-    for (int wordID : wordSet)
+    row.assign(docID);
+    row += ',';
+
+    char digits[16];
+    for (size_t i = 0; i < wordIDs.size(); ++i)
     {
-        if (!first)
-            out << ";";
-        first = false;
-        out << wordID;
+        if (i)
+            row += ';';
+        row.append(digits, std::to_chars(digits, digits + sizeof(digits), wordIDs[i]).ptr);
     }
 
-    out << "\n";
+    row += '\n';
+    out.write(row.data(), row.size());
 }
@@ -2,10 +2,12 @@
 #define FORWARD_INDEX_H
 
 #include <string>
-#include <unordered_set>
+#include <vector>
 
+// Appends docID,wordID;wordID;... to data/forward_index.csv. wordIDs
+// must not repeat. The file stays open for the whole run.
 void writeForwardIndex(
     const std::string &docID,
-    const std::unordered_set<int> &wordSet);
+    const std::vector<int> &wordIDs);
 
 #endif
@@ -0,0 +1,474 @@
+#include "index_image.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+const char MAGIC[4] = {'I', 'M', 'G', '1'};
+const uint32_t VERSION = 8;
+
+enum Section
+{
+    SECTION_LEXICON,
+    SECTION_POSTINGS,
+    SECTION_DOCS,
+    SECTION_COMPLETIONS,
+    SECTION_SPELLING,
+    SECTION_BLOCKS,
+    SECTION_POSITIONS,
+    SECTION_FIELD_LENGTHS,
+    SECTION_FIELD_FREQS,
+    SECTION_COUNT
+};
+
+struct ImageHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t offset[SECTION_COUNT];
+    uint64_t size[SECTION_COUNT];
+};
+
+template <typename T>
+void appendPod(std::vector<uint8_t> &out, const T &v)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+void padTo8(std::vector<uint8_t> &out)
+{
+    out.resize((out.size() + 7) & ~size_t(7), 0);
+}
+
+void appendVByte(std::vector<uint8_t> &out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+// A doc's tokens per ScoredField; a doc without them is all body
+void effectiveFieldLengths(const ImageDoc &d, uint32_t *out)
+{
+    uint32_t known = 0;
+    for (int f = 0; f < SCORED_FIELDS; ++f)
+    {
+        out[f] = d.fieldLengths[f];
+        known += d.fieldLengths[f];
+    }
+    if (known == 0)
+        out[FIELD_BODY] = d.length;
+}
+
+inline const uint8_t *readVByte(const uint8_t *in, uint32_t &v)
+{
+    v = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        uint8_t byte = *in++;
+        v |= (uint32_t)(byte & 0x7F) << shift;
+        if (byte < 0x80 || shift >= 28)
+            return in;
+    }
+}
+} // namespace
+
+// ============================================
+// WRITER
+// ============================================
+
+bool writeIndexImage(const std::string &path,
+                     std::vector<std::pair<std::string, int>> lexicon,
+                     const std::vector<uint8_t> &postingsFile,
+                     const std::vector<ImageDoc> &docs,
+                     const PositionSource &positions,
+                     const FieldFreqSource &fieldFreqs)
+{
+    PostingsReader postings;
+    if (!postings.attach(postingsFile.data(), postingsFile.size()))
+        return false;
+
+    ImageHeader header{};
+    std::memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+
+    std::vector<uint8_t> image(sizeof(ImageHeader));
+    padTo8(image);
+
+    // Lexicon
+    header.offset[SECTION_LEXICON] = image.size();
+    std::vector<std::pair<std::string, uint32_t>> completions; // word, df
+    std::vector<LexiconWord> words;
+    completions.reserve(lexicon.size());
+    words.reserve(lexicon.size());
+    for (auto &w : lexicon)
+    {
+        LexiconWord lw;
+        lw.word = std::move(w.first);
+        lw.wordID = w.second;
+        if (const TermEntry *e = postings.find(w.second))
+        {
+            lw.df = e->df;
+            lw.termIndex = (uint32_t)(e - &postings.entry(0));
+        }
+        completions.emplace_back(lw.word, lw.df);
+        words.push_back(std::move(lw));
+    }
+    if (!writeStaticLexicon(words, image))
+        return false;
+    header.size[SECTION_LEXICON] = image.size() - header.offset[SECTION_LEXICON];
+    padTo8(image);
+
+    // Postings, copied verbatim
+    header.offset[SECTION_POSTINGS] = image.size();
+    image.insert(image.end(), postingsFile.begin(), postingsFile.end());
+    header.size[SECTION_POSTINGS] = postingsFile.size();
+    padTo8(image);
+
+    // Docs
+    header.offset[SECTION_DOCS] = image.size();
+    long long totalLength = 0;
+    for (auto &d : docs)
+        totalLength += d.length;
+    appendPod(image, (uint64_t)docs.size());
+    appendPod(image, docs.empty() ? 1.0 : (double)totalLength / docs.size());
+    uint64_t textOffset = 0;
+    for (auto &d : docs)
+    {
+        DocRecord r{};
+        r.textOffset = textOffset;
+        for (int f = 0; f < DOC_FIELDS; ++f)
+        {
+            r.fieldLength[f] = (uint32_t)d.fields[f].size();
+            textOffset += r.fieldLength[f];
+        }
+        r.length = d.length;
+        appendPod(image, r);
+    }
+    for (auto &d : docs)
+        for (int f = 0; f < DOC_FIELDS; ++f)
+            image.insert(image.end(), d.fields[f].begin(), d.fields[f].end());
+    header.size[SECTION_DOCS] = image.size() - header.offset[SECTION_DOCS];
+    padTo8(image);
+
+    // Field lengths
+    header.offset[SECTION_FIELD_LENGTHS] = image.size();
+    std::vector<uint32_t> fieldLengths(docs.size() * SCORED_FIELDS);
+    double fieldTotals[SCORED_FIELDS] = {};
+    for (size_t d = 0; d < docs.size(); ++d)
+    {
+        effectiveFieldLengths(docs[d], &fieldLengths[d * SCORED_FIELDS]);
+        for (int f = 0; f < SCORED_FIELDS; ++f)
+            fieldTotals[f] += fieldLengths[d * SCORED_FIELDS + f];
+    }
+    for (int f = 0; f < SCORED_FIELDS; ++f)
+        appendPod(image, docs.empty() ? 0.0 : fieldTotals[f] / docs.size());
+    for (uint32_t length : fieldLengths)
+        appendPod(image, length);
+    header.size[SECTION_FIELD_LENGTHS] = image.size() - header.offset[SECTION_FIELD_LENGTHS];
+    padTo8(image);
+
+    // Completions
+    header.offset[SECTION_COMPLETIONS] = image.size();
+    std::sort(completions.begin(), completions.end());
+    std::vector<std::string> sortedWords;
+    std::vector<uint32_t> weights;
+    sortedWords.reserve(completions.size());
+    weights.reserve(completions.size());
+    for (auto &c : completions)
+    {
+        sortedWords.push_back(std::move(c.first));
+        weights.push_back(c.second);
+    }
+    PrefixDictionary::write(sortedWords, weights, image);
+    header.size[SECTION_COMPLETIONS] = image.size() - header.offset[SECTION_COMPLETIONS];
+    padTo8(image);
+
+    // Spelling, over the completion words
+    header.offset[SECTION_SPELLING] = image.size();
+    SpellingIndex::write(sortedWords, image);
+    header.size[SECTION_SPELLING] = image.size() - header.offset[SECTION_SPELLING];
+    padTo8(image);
+
+    // Posting blocks: find where each block starts in the doc and freq
+    // streams by decoding them. The positions and field freqs of each
+    // block are gathered on the way.
+    header.offset[SECTION_BLOCKS] = image.size();
+    std::vector<uint32_t> firstBlock;
+    std::vector<PostingBlock> blocks;
+    std::vector<uint32_t> scratch(BITPACK_BLOCK);
+    PostingList list;
+    std::vector<uint64_t> positionOffsets;
+    std::vector<uint8_t> positionBytes, gapBytes;
+    std::vector<uint32_t> docPositions;
+    bool anyPositions = false;
+    std::vector<FieldBlock> fieldBlocks;
+    std::vector<uint64_t> fieldFreqOffsets;
+    std::vector<uint8_t> fieldFreqBytes;
+    std::vector<uint32_t> blockFieldFreqs[SCORED_FIELDS];
+    for (size_t t = 0; t < postings.termCount(); ++t)
+    {
+        const TermEntry &e = postings.entry(t);
+        const uint8_t *docStream = postings.termData(e);
+        postings.read(e, list);
+        firstBlock.push_back((uint32_t)blocks.size());
+
+        uint32_t docOffset = 0, freqOffset = 0;
+        for (uint32_t start = 0; start < e.df; start += BITPACK_BLOCK)
+        {
+            uint32_t count = std::min<uint32_t>(BITPACK_BLOCK, e.df - start);
+            PostingBlock block{};
+            block.lastDoc = list.docs[start + count - 1];
+            block.docOffset = docOffset;
+            block.freqOffset = freqOffset;
+            block.minLength = UINT32_MAX;
+            positionOffsets.push_back(positionBytes.size());
+            FieldBlock fieldBlock{};
+            for (int f = 0; f < SCORED_FIELDS; ++f)
+            {
+                fieldBlock.minLength[f] = UINT32_MAX;
+                blockFieldFreqs[f].clear();
+            }
+            for (uint32_t i = start; i < start + count; ++i)
+            {
+                block.maxFreq = std::max(block.maxFreq, list.freqs[i]);
+                if (list.docs[i] < docs.size())
+                    block.minLength = std::min(block.minLength, docs[list.docs[i]].length);
+
+                uint32_t freqs[SCORED_FIELDS] = {};
+                if (!fieldFreqs || !fieldFreqs(e.wordID, list.docs[i], freqs))
+                {
+                    // Not in a field that has no tokens, e.g. a title
+                    // the image does not know
+                    int best = std::min<uint32_t>(std::max<uint32_t>(list.fields[i], 1), SCORED_FIELDS) - 1;
+                    if (list.docs[i] >= docs.size() || fieldLengths[list.docs[i] * SCORED_FIELDS + best] == 0)
+                        best = FIELD_BODY;
+                    freqs[best] = std::min<uint32_t>(list.freqs[i], 1);
+                    freqs[FIELD_BODY] += list.freqs[i] - freqs[best];
+                }
+                for (int f = 0; f < SCORED_FIELDS; ++f)
+                {
+                    blockFieldFreqs[f].push_back(freqs[f]);
+                    fieldBlock.maxFreq[f] = std::max(fieldBlock.maxFreq[f], freqs[f]);
+                    if (list.docs[i] < docs.size())
+                        fieldBlock.minLength[f] =
+                            std::min(fieldBlock.minLength[f], fieldLengths[list.docs[i] * SCORED_FIELDS + f]);
+                }
+
+                docPositions.clear();
+                gapBytes.clear();
+                if (positions && positions(e.wordID, list.docs[i], docPositions))
+                {
+                    anyPositions = true;
+                    uint32_t prev = 0;
+                    for (uint32_t p : docPositions)
+                    {
+                        appendVByte(gapBytes, p - prev);
+                        prev = p;
+                    }
+                }
+                appendVByte(positionBytes, (uint32_t)gapBytes.size());
+                positionBytes.insert(positionBytes.end(), gapBytes.begin(), gapBytes.end());
+            }
+            blocks.push_back(block);
+            fieldBlocks.push_back(fieldBlock);
+            fieldFreqOffsets.push_back(fieldFreqBytes.size());
+            for (int f = 0; f < SCORED_FIELDS; ++f)
+                encodeStream(postings.getCodec(), blockFieldFreqs[f], fieldFreqBytes);
+            docOffset += (uint32_t)decodeStream(postings.getCodec(), docStream + docOffset, count, scratch.data());
+            freqOffset += (uint32_t)decodeStream(postings.getCodec(), docStream + e.docBytes + freqOffset, count,
+                                                 scratch.data());
+        }
+    }
+    firstBlock.push_back((uint32_t)blocks.size());
+    appendPod(image, (uint64_t)blocks.size());
+    for (uint32_t f : firstBlock)
+        appendPod(image, f);
+    for (const PostingBlock &block : blocks)
+        appendPod(image, block);
+    header.size[SECTION_BLOCKS] = image.size() - header.offset[SECTION_BLOCKS];
+    padTo8(image);
+
+    // Positions, only if any were known
+    header.offset[SECTION_POSITIONS] = image.size();
+    if (anyPositions)
+    {
+        positionOffsets.push_back(positionBytes.size());
+        appendPod(image, (uint64_t)blocks.size());
+        for (uint64_t offset : positionOffsets)
+            appendPod(image, offset);
+        image.insert(image.end(), positionBytes.begin(), positionBytes.end());
+    }
+    else
+        appendPod(image, (uint64_t)0);
+    header.size[SECTION_POSITIONS] = image.size() - header.offset[SECTION_POSITIONS];
+    padTo8(image);
+
+    // Field freqs
+    header.offset[SECTION_FIELD_FREQS] = image.size();
+    fieldFreqOffsets.push_back(fieldFreqBytes.size());
+    appendPod(image, (uint64_t)blocks.size());
+    for (const FieldBlock &block : fieldBlocks)
+        appendPod(image, block);
+    for (uint64_t offset : fieldFreqOffsets)
+        appendPod(image, offset);
+    image.insert(image.end(), fieldFreqBytes.begin(), fieldFreqBytes.end());
+    header.size[SECTION_FIELD_FREQS] = image.size() - header.offset[SECTION_FIELD_FREQS];
+
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+    out.write(reinterpret_cast<const char *>(image.data()), image.size());
+    return out.good();
+}
+
+// ============================================
+// READER
+// ============================================
+
+bool IndexImage::open(const std::string &path)
+{
+    if (!file.open(path))
+        return false;
+
+    const uint8_t *base = file.data();
+    ImageHeader header;
+    if (file.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION)
+        return false;
+    for (int s = 0; s < SECTION_COUNT; ++s)
+        if (header.offset[s] % 8 != 0 || header.offset[s] + header.size[s] > file.size())
+            return false;
+
+    if (!lexicon.attach(base + header.offset[SECTION_LEXICON], header.size[SECTION_LEXICON]) ||
+        !postingsReader.attach(base + header.offset[SECTION_POSTINGS], header.size[SECTION_POSTINGS]) ||
+        !completionDict.attach(base + header.offset[SECTION_COMPLETIONS], header.size[SECTION_COMPLETIONS]) ||
+        !spellingIndex.attach(base + header.offset[SECTION_SPELLING], header.size[SECTION_SPELLING]))
+        return false;
+
+    const uint8_t *blockSection = base + header.offset[SECTION_BLOCKS];
+    uint64_t blocksOffset = 8 + 4ull * (postingsReader.termCount() + 1);
+    if (blocksOffset > header.size[SECTION_BLOCKS])
+        return false;
+    uint64_t blockTotal;
+    std::memcpy(&blockTotal, blockSection, sizeof(blockTotal));
+    if (blocksOffset + blockTotal * sizeof(PostingBlock) > header.size[SECTION_BLOCKS])
+        return false;
+    firstBlock = reinterpret_cast<const uint32_t *>(blockSection + 8);
+    postingBlocks = reinterpret_cast<const PostingBlock *>(blockSection + blocksOffset);
+    if (firstBlock[postingsReader.termCount()] != blockTotal)
+        return false;
+
+    const uint8_t *positionSection = base + header.offset[SECTION_POSITIONS];
+    uint64_t positionBlocks = 0;
+    if (header.size[SECTION_POSITIONS] >= 8)
+        std::memcpy(&positionBlocks, positionSection, sizeof(positionBlocks));
+    if (positionBlocks > 0)
+    {
+        uint64_t dataOffset = 8 + 8 * (positionBlocks + 1);
+        if (positionBlocks != blockTotal || dataOffset > header.size[SECTION_POSITIONS])
+            return false;
+        positionOffsets = reinterpret_cast<const uint64_t *>(positionSection + 8);
+        positionData = positionSection + dataOffset;
+        if (positionOffsets[positionBlocks] != header.size[SECTION_POSITIONS] - dataOffset)
+            return false;
+    }
+
+    const uint8_t *fieldFreqSection = base + header.offset[SECTION_FIELD_FREQS];
+    uint64_t fieldBlockTotal = 0;
+    if (header.size[SECTION_FIELD_FREQS] >= 8)
+        std::memcpy(&fieldBlockTotal, fieldFreqSection, sizeof(fieldBlockTotal));
+    uint64_t fieldFreqOffset = 8 + blockTotal * sizeof(FieldBlock);
+    uint64_t fieldDataOffset = fieldFreqOffset + 8 * (blockTotal + 1);
+    if (fieldBlockTotal != blockTotal || fieldDataOffset > header.size[SECTION_FIELD_FREQS])
+        return false;
+    fieldBlocks = reinterpret_cast<const FieldBlock *>(fieldFreqSection + 8);
+    fieldFreqOffsets = reinterpret_cast<const uint64_t *>(fieldFreqSection + fieldFreqOffset);
+    fieldFreqData = fieldFreqSection + fieldDataOffset;
+    if (fieldFreqOffsets[blockTotal] != header.size[SECTION_FIELD_FREQS] - fieldDataOffset)
+        return false;
+
+    const uint8_t *docSection = base + header.offset[SECTION_DOCS];
+    uint64_t docTotal;
+    std::memcpy(&docTotal, docSection, sizeof(docTotal));
+    std::memcpy(&avgLength, docSection + 8, sizeof(avgLength));
+    if (16 + docTotal * sizeof(DocRecord) > header.size[SECTION_DOCS])
+        return false;
+    const uint8_t *fieldLengthSection = base + header.offset[SECTION_FIELD_LENGTHS];
+    if (sizeof(avgFieldLengths) + docTotal * SCORED_FIELDS * 4 > header.size[SECTION_FIELD_LENGTHS])
+        return false;
+    std::memcpy(avgFieldLengths, fieldLengthSection, sizeof(avgFieldLengths));
+    docFieldLengths = reinterpret_cast<const uint32_t *>(fieldLengthSection + sizeof(avgFieldLengths));
+    numDocs = (size_t)docTotal;
+    docs = reinterpret_cast<const DocRecord *>(docSection + 16);
+    docText = reinterpret_cast<const char *>(docs + numDocs);
+    return true;
+}
+
+int IndexImage::wordID(std::string_view w) const
+{
+    const LexEntry *e = lexicon.find(w);
+    return e ? e->wordID : -1;
+}
+
+uint32_t IndexImage::docFrequency(std::string_view w) const
+{
+    const LexEntry *e = lexicon.find(w);
+    return e ? e->df : 0;
+}
+
+const TermEntry *IndexImage::term(std::string_view w) const
+{
+    const LexEntry *e = lexicon.find(w);
+    if (!e || e->termIndex >= postingsReader.termCount())
+        return nullptr; // NO_TERM, or a damaged image
+    return &postingsReader.entry(e->termIndex);
+}
+
+std::string_view IndexImage::docField(uint32_t doc, DocField field) const
+{
+    const DocRecord &r = docs[doc];
+    uint64_t offset = r.textOffset;
+    for (int f = 0; f < field; ++f)
+        offset += r.fieldLength[f];
+    return std::string_view(docText + offset, r.fieldLength[field]);
+}
+
+const uint8_t *skipPositions(const uint8_t *in)
+{
+    uint32_t bytes;
+    in = readVByte(in, bytes);
+    return in + bytes;
+}
+
+void readFieldFreqs(PostingsCodec codec, const uint8_t *in, uint32_t count, uint32_t (*freqs)[BITPACK_BLOCK])
+{
+    for (int f = 0; f < SCORED_FIELDS; ++f)
+        in += decodeStream(codec, in, count, freqs[f]);
+}
+
+const uint8_t *readPositions(const uint8_t *in, std::vector<uint32_t> &out)
+{
+    out.clear();
+    uint32_t bytes;
+    in = readVByte(in, bytes);
+    const uint8_t *end = in + bytes;
+    uint32_t position = 0;
+    while (in < end)
+    {
+        uint32_t gap;
+        in = readVByte(in, gap);
+        position += gap;
+        out.push_back(position);
+    }
+    return end;
+}
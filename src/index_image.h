@@ -0,0 +1,213 @@
+#ifndef INDEX_IMAGE_H
+#define INDEX_IMAGE_H
+
+#include "mapped_file.h"
+#include "postings_format.h"
+#include "prefix_dictionary.h"
+#include "spelling_index.h"
+#include "static_lexicon.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Everything the search server needs in one file (data/index.img),
+// host byte order:
+//
+//   header    "IMG1", version, offset and size of each section
+//   lexicon   a StaticLexicon (static_lexicon.h) with each word's df and
+//             the index of its posting list
+//   postings  a complete postings.bin (see postings_format.h)
+//   docs      docCount, avgDocLength, DocRecord x docCount, text bytes
+//   completions  the lexicon's words as a PrefixDictionary weighted by
+//             df, for autocomplete
+//   spelling  a SpellingIndex over the completion words, for "did you
+//             mean" suggestions
+//   blocks    blockCount, first block of each posting list x
+//             (termCount + 1), then PostingBlock x blockCount
+//   positions blockCount (0 if the image has no positions), u64 offset
+//             of each block's positions x (blockCount + 1), then the
+//             positions: per posting, in the order of the postings, a
+//             VByte byte count and then the word's positions in the doc
+//             as VByte gaps; none if they are not known
+//   field lengths  average tokens per ScoredField (double x
+//             SCORED_FIELDS), then u32 x SCORED_FIELDS per doc
+//   field freqs  blockCount, FieldBlock x blockCount, u64 offset of each
+//             block's freqs x (blockCount + 1), then per block one
+//             stream per ScoredField of its postings' term frequency in
+//             that field, in the postings' codec
+//
+// Sections start on 8-byte boundaries and all records are fixed width,
+// so the image is mapped and used in place: opening it only checks the
+// header, and servers on one host share the mapped pages.
+
+enum DocField
+{
+    DOC_CORD_ID,
+    DOC_URL,
+    DOC_TITLE,
+    DOC_AUTHORS,
+    DOC_ABSTRACT,
+    DOC_FIELDS
+};
+
+struct DocRecord
+{
+    uint64_t textOffset;                // into the docs section's text bytes
+    uint32_t fieldLength[DOC_FIELDS];   // the fields are stored back to back
+    uint32_t length;                    // total tokens, for BM25
+};
+static_assert(sizeof(DocRecord) == 32, "DocRecord is stored as-is in index.img");
+
+// The fields BM25F scores separately; the postings' field priorities
+// 1, 2 and 3, less one
+enum ScoredField
+{
+    FIELD_TITLE,
+    FIELD_ABSTRACT,
+    FIELD_BODY,
+    SCORED_FIELDS
+};
+
+// Summary of BITPACK_BLOCK consecutive postings of a list (the last
+// block may be shorter), in the order of the postings term table.
+// Blocks line up with the bit-packed codec's blocks, so one can be
+// decoded on its own, and a search can skip whole blocks by lastDoc or
+// by the score bound that maxFreq and minLength give.
+struct PostingBlock
+{
+    uint32_t lastDoc;    // doc number of the block's last posting
+    uint32_t docOffset;  // into the term's doc-gap stream
+    uint32_t freqOffset; // into the term's freq stream
+    uint32_t maxFreq;    // highest term frequency in the block
+    uint32_t minLength;  // shortest doc in the block
+};
+static_assert(sizeof(PostingBlock) == 20, "PostingBlock is stored as-is in index.img");
+
+// The same block per field, for a BM25F bound: the highest frequency in
+// the field and the shortest field of the block's docs
+struct FieldBlock
+{
+    uint32_t maxFreq[SCORED_FIELDS];
+    uint32_t minLength[SCORED_FIELDS];
+};
+static_assert(sizeof(FieldBlock) == 24, "FieldBlock is stored as-is in index.img");
+
+// Input for writeIndexImage: one per doc number.
+struct ImageDoc
+{
+    std::string fields[DOC_FIELDS];
+    uint32_t length = 0;
+    uint32_t fieldLengths[SCORED_FIELDS] = {}; // tokens; all 0 counts length as body
+};
+
+// Fills out with the token positions of a word in a doc, ascending;
+// false if they are not known (stored as an empty list). writeIndexImage
+// asks for every posting once, by wordID and then doc, so a source can
+// read its input in order.
+using PositionSource = std::function<bool(int wordID, uint32_t doc, std::vector<uint32_t> &out)>;
+
+// Fills freqs with a word's term frequency in each ScoredField of a doc;
+// false if they are not known. Asked in the same order as positions.
+using FieldFreqSource = std::function<bool(int wordID, uint32_t doc, uint32_t *freqs)>;
+
+// lexicon is (word, wordID) in any order, each word once; postingsFile is the raw
+// content of postings.bin, which also supplies each word's df. Without
+// positions the image has none, and phrases cannot be checked in it. A
+// posting whose field freqs are not known has one occurrence in its
+// best field (from postings.bin), if that field has any tokens, and the
+// rest in the body.
+bool writeIndexImage(const std::string &path,
+                     std::vector<std::pair<std::string, int>> lexicon,
+                     const std::vector<uint8_t> &postingsFile,
+                     const std::vector<ImageDoc> &docs,
+                     const PositionSource &positions = nullptr,
+                     const FieldFreqSource &fieldFreqs = nullptr);
+
+// Reading one posting's positions from the positions section: each
+// returns where the next posting's start.
+const uint8_t *skipPositions(const uint8_t *in);
+const uint8_t *readPositions(const uint8_t *in, std::vector<uint32_t> &out);
+
+// Decodes the field freqs of a block of count postings:
+// freqs[f][i] for posting i
+void readFieldFreqs(PostingsCodec codec, const uint8_t *in, uint32_t count,
+                    uint32_t (*freqs)[BITPACK_BLOCK]);
+
+class IndexImage
+{
+private:
+    MappedFile file;
+    StaticLexicon lexicon;
+    PostingsReader postingsReader;
+    PrefixDictionary completionDict;
+    SpellingIndex spellingIndex;
+    const uint32_t *firstBlock = nullptr;
+    const PostingBlock *postingBlocks = nullptr;
+    const uint64_t *positionOffsets = nullptr; // by block; nullptr without positions
+    const uint8_t *positionData = nullptr;
+    const uint32_t *docFieldLengths = nullptr;  // SCORED_FIELDS per doc
+    double avgFieldLengths[SCORED_FIELDS] = {};
+    const FieldBlock *fieldBlocks = nullptr;
+    const uint64_t *fieldFreqOffsets = nullptr;
+    const uint8_t *fieldFreqData = nullptr;
+    const DocRecord *docs = nullptr;
+    const char *docText = nullptr;
+    size_t numDocs = 0;
+    double avgLength = 1.0;
+
+public:
+    bool open(const std::string &path);
+
+    // Lexicon, in hash slot order
+    size_t wordCount() const { return lexicon.size(); }
+    std::string_view word(size_t i) const { return lexicon.word(i); }
+    int wordID(std::string_view word) const; // -1 if not in the lexicon
+    uint32_t docFrequency(std::string_view word) const; // 0 if not in the lexicon
+
+    // The posting list of word, without a search of the term table;
+    // nullptr if the word has no postings here.
+    const TermEntry *term(std::string_view word) const;
+
+    const PostingsReader &postings() const { return postingsReader; }
+
+    // The blocks of a posting list from postings(); there are
+    // ceil(e.df / BITPACK_BLOCK) of them.
+    const PostingBlock *blocks(const TermEntry &e) const
+    {
+        return postingBlocks + firstBlock[&e - &postingsReader.entry(0)];
+    }
+
+    // Where the positions of a block's postings start (skipPositions,
+    // readPositions); nullptr if the image has no positions. Kept apart
+    // from the postings, so only phrase queries read them.
+    bool hasPositions() const { return positionOffsets != nullptr; }
+    const uint8_t *blockPositions(const PostingBlock *block) const
+    {
+        return positionOffsets ? positionData + positionOffsets[block - postingBlocks] : nullptr;
+    }
+
+    // Per field bounds and freqs of a block (readFieldFreqs)
+    const FieldBlock &fieldBlock(const PostingBlock *block) const { return fieldBlocks[block - postingBlocks]; }
+    const uint8_t *blockFieldFreqs(const PostingBlock *block) const
+    {
+        return fieldFreqData + fieldFreqOffsets[block - postingBlocks];
+    }
+
+    // The lexicon's words in sorted order, weighted by df
+    const PrefixDictionary &completions() const { return completionDict; }
+
+    // Delete index whose matches are completions() indexes
+    const SpellingIndex &spelling() const { return spellingIndex; }
+
+    size_t docCount() const { return numDocs; }
+    double avgDocLength() const { return avgLength; }
+    uint32_t docLength(uint32_t doc) const { return docs[doc].length; }
+    const uint32_t *fieldLengths(uint32_t doc) const { return docFieldLengths + (size_t)doc * SCORED_FIELDS; }
+    double avgFieldLength(int field) const { return avgFieldLengths[field]; }
+    std::string_view docField(uint32_t doc, DocField field) const;
+};
+
+#endif
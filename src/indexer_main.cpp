@@ -1,91 +1,59 @@
-#include "tokenizer.h"
 #include "lexicon.h"
-#include "forward_index.h"
 #include "inverted_index.h"
+#include "ingest_pipeline.h"
+#include "segments.h"
 #include <filesystem>
-#include <fstream>
-#include <sstream>
 #include <iostream>
-#include <vector>
-
-namespace fs = std::filesystem;
+#include <string>
+
+// Usage: indexer [--threads N] [--metadata path] [--json-dir path] [--memory-mb N] [--codec vbyte|bitpack]
+//                [--segments dir]
+// Documents already in a live segment are skipped, so indexing a new
+// CORD-19 drop only processes the rows it added.
+int main(int argc, char **argv) {
+    IngestOptions opt;
+    opt.metadataPath = "C:/Users/HC/Serach-Engine - Copy/cord-19_2020-05-26/2020-05-26/metadata.csv";
+    opt.jsonFolder = "C:/Users/HC/Serach-Engine - Copy/cord-19_2020-05-26/2020-05-26/document_parses/document_parses/pmc_json/";
+    std::string segmentDir = "data/segments";
+
+    for(int i=1;i+1<argc;i+=2){
+        std::string flag = argv[i];
+        if(flag=="--threads") opt.threads = std::stoi(argv[i+1]);
+        else if(flag=="--metadata") opt.metadataPath = argv[i+1];
+        else if(flag=="--json-dir") opt.jsonFolder = argv[i+1];
+        else if(flag=="--memory-mb") opt.memoryLimitMB = std::stoul(argv[i+1]);
+        else if(flag=="--codec") opt.codec = std::string(argv[i+1])=="bitpack" ? PostingsCodec::BitPacked : PostingsCodec::VByte;
+        else if(flag=="--segments") segmentDir = argv[i+1];
+        else { std::cerr << "Unknown option " << flag << "\n"; return 1; }
+    }
 
-int main() {
     Lexicon lex;
     lex.load("data/lexicon.csv");
 
-    std::string metadataPath = "C:/Users/HC/Serach-Engine - Copy/cord-19_2020-05-26/2020-05-26/metadata.csv";
-    std::string jsonFolder = "C:/Users/HC/Serach-Engine - Copy/cord-19_2020-05-26/2020-05-26/document_parses/document_parses/pmc_json/";
-
-    std::ifstream meta(metadataPath);
-    if(!meta.is_open()){
-        std::cerr << "Cannot open metadata.csv at " << metadataPath << "\n";
-        return 1;
+    // Docs already in a live segment
+    SegmentedIndex live;
+    if(live.open(segmentDir)){
+        for(uint32_t d=0; d<live.docCount(); ++d)
+            opt.skipDocs.insert(std::string(live.docField(d, DOC_CORD_ID)));
+        std::cout << "Skipping " << opt.skipDocs.size() << " docs in " << live.segmentCount() << " live segment(s)\n";
     }
+    opt.segmentPath = newSegmentPath(segmentDir);
 
-    std::string header;
-    getline(meta, header); // skip header
-
-    std::string line;
-    int docCount = 0;
-
-    while(getline(meta,line)) {
-        if(line.empty()) continue;
-
-        std::stringstream ss(line);
-        std::vector<std::string> cols;
-        std::string col;
-        while(getline(ss,col,',')) cols.push_back(col);
-
-        std::string docID = (cols.size()>0)?cols[0]:"";
-        std::string title = (cols.size()>2)?cols[2]:"";
-        std::string abstractText = (cols.size()>8)?cols[8]:"";
-
-        // Read JSON body
-        std::string body;
-        std::string jsonPath = jsonFolder + docID + ".json";
-        if(fs::exists(jsonPath)) {
-            std::ifstream jf(jsonPath);
-            if(jf.is_open()){
-                std::string jline;
-                while(getline(jf,jline)) body += jline + " ";
-                jf.close();
-            }
-        }
+    int docCount = runIngestPipeline(lex, opt);
+    if(docCount < 0) return 1;
 
-        // Tokenize sections
-       std::unordered_map<int,int> freqMap;   // still needed for inverted index
-std::unordered_map<int,std::vector<int>> posMap;
-std::unordered_set<int> wordSet;       // NEW: for forward index
-
-
-        auto processText = [&](const std::string &text, int priority){
-            auto words = tokenize(text);
-            for(size_t i=0;i<words.size();++i){
-                int wid = lex.getWordID(words[i]);
-                freqMap[wid]++;
-                posMap[wid].push_back(i);
-                wordSet.insert(wid); 
-                writeInverted(wid, docID, freqMap[wid], priority, posMap[wid]);
-            }
-        };
-
-        processText(title,1);
-        processText(abstractText,2);
-        processText(body,3);
+    lex.save("data/lexicon.csv");
 
-        writeForwardIndex(docID,wordSet);
+    if(!validatePostings("data/postings.csv"))
+        std::cerr << "Warning: data/postings.csv failed validation\n";
 
-        ++docCount;
-        if((docCount&127)==0) std::cout << "Processed docs: " << docCount << "\r";
+    if(docCount == 0){
+        std::filesystem::remove(opt.segmentPath);
+    } else if(!commitSegment(segmentDir, opt.segmentPath, docCount)){
+        std::cerr << "Cannot commit segment " << opt.segmentPath << "\n";
+        return 1;
     }
 
-    meta.close();
-    lex.save("data/lexicon.csv");
-
-    // build postings.csv
-    buildPostings();
-
-    std::cout << "\nIndexing finished! Total docs: " << docCount << "\n";
+    std::cout << "\nIndexing finished! New docs: " << docCount << "\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,559 @@
+#include "ingest_pipeline.h"
+#include "alloc_stats.h"
+#include "arena.h"
+#include "bounded_queue.h"
+#include "body_text_extractor.h"
+#include "tokenizer.h"
+#include "text_normalizer.h"
+#include "forward_index.h"
+#include "inverted_index.h"
+#include "spimi.h"
+#include "doc_table.h"
+#include "index_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+struct RawDoc
+{
+    long seq = 0;
+    std::string docID;
+    std::string url;
+    std::string title;
+    std::string authors;
+    std::string abstractText;
+    std::string body;
+};
+
+// Everything one document contributes for one word.
+struct TermHits
+{
+    std::string_view word; // in TokenizedDoc::arena
+    int freq = 0;
+    int priority = 0;
+    uint32_t firstPosition = 0; // positions[firstPosition, firstPosition + freq)
+    uint32_t fieldFreqs[SCORED_FIELDS] = {}; // freq per field, by priority - 1
+};
+
+// Tokenized documents are recycled: the inverter hands each one back
+// to the workers once it is written, so the arena and vectors keep
+// their capacity and a document no larger than earlier ones is
+// analyzed without heap allocation.
+struct TokenizedDoc
+{
+    long seq = 0;
+    std::string docID;
+    std::string url;
+    std::string title;
+    std::string authors;
+    std::string abstractText;
+    int length = 0; // tokens in title + abstract + body
+    uint32_t fieldLengths[SCORED_FIELDS] = {};
+    Arena arena;
+    std::vector<TermHits> terms; // first-seen order
+    std::vector<int> positions;  // grouped by term
+};
+
+// Word -> slot in TokenizedDoc::terms for the document being analyzed.
+// Open addressing over a power-of-two table; an epoch stamp per slot
+// makes clear() O(1), so the table is sized once and then reused.
+class TermTable
+{
+private:
+    struct Slot
+    {
+        uint32_t epoch = 0;
+        uint32_t hash = 0;
+        int term = 0;
+    };
+
+    std::vector<Slot> slots = std::vector<Slot>(1024);
+    uint32_t epoch = 1;
+    size_t used = 0;
+
+    void grow()
+    {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (const Slot &s : old)
+        {
+            if (s.epoch != epoch)
+                continue;
+            size_t i = s.hash & mask;
+            while (slots[i].epoch == epoch)
+                i = (i + 1) & mask;
+            slots[i] = s;
+        }
+    }
+
+public:
+    void clear()
+    {
+        used = 0;
+        if (++epoch == 0)
+        {
+            std::fill(slots.begin(), slots.end(), Slot());
+            epoch = 1;
+        }
+    }
+
+    // Returns the slot of word, adding it as newTerm when missing.
+    int findOrAdd(std::string_view word, const std::vector<TermHits> &terms, int newTerm, bool &added)
+    {
+        if ((used + 1) * 2 > slots.size())
+            grow();
+
+        uint32_t hash = (uint32_t)std::hash<std::string_view>()(word);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            Slot &s = slots[i];
+            if (s.epoch != epoch)
+            {
+                s = {epoch, hash, newTerm};
+                ++used;
+                added = true;
+                return newTerm;
+            }
+            if (s.hash == hash && terms[s.term].word == word)
+            {
+                added = false;
+                return s.term;
+            }
+        }
+    }
+};
+
+// Heap allocations per document in the tokenize and invert stages.
+struct AllocationCounts
+{
+    std::atomic<uint64_t> analyze{0};
+    std::atomic<uint64_t> emit{0};
+};
+
+// Where one word's positions in a doc are kept in SegmentContent
+struct SegmentTerm
+{
+    int wordID;
+    uint32_t count;
+    uint64_t offset; // VByte gaps in SegmentContent::positionBytes
+    uint32_t fieldFreqs[SCORED_FIELDS];
+};
+
+// What a run needs to keep to write itself out as a segment.
+struct SegmentContent
+{
+    std::vector<ImageDoc> docs;
+    std::unordered_map<int, std::string> words; // wordID -> word
+    std::vector<SegmentTerm> terms;             // per doc, sorted by wordID
+    std::vector<size_t> docTerms{0};            // first of each doc's terms, and the end
+    std::vector<uint8_t> positionBytes;
+
+    void addTerm(int wordID, const int *positions, size_t count, const uint32_t *fieldFreqs,
+                 std::vector<uint32_t> &gaps)
+    {
+        gaps.clear();
+        int prev = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            gaps.push_back((uint32_t)(positions[i] - prev));
+            prev = positions[i];
+        }
+        SegmentTerm term{wordID, (uint32_t)count, positionBytes.size(), {}};
+        std::copy(fieldFreqs, fieldFreqs + SCORED_FIELDS, term.fieldFreqs);
+        terms.push_back(term);
+        encodeStream(PostingsCodec::VByte, gaps, positionBytes);
+    }
+
+    void endDoc()
+    {
+        std::sort(terms.begin() + docTerms.back(), terms.end(),
+                  [](const SegmentTerm &a, const SegmentTerm &b) { return a.wordID < b.wordID; });
+        docTerms.push_back(terms.size());
+    }
+
+    const SegmentTerm *find(int wordID, uint32_t doc) const
+    {
+        if (doc + 1 >= docTerms.size())
+            return nullptr;
+        auto first = terms.begin() + docTerms[doc], last = terms.begin() + docTerms[doc + 1];
+        auto it = std::lower_bound(first, last, wordID,
+                                   [](const SegmentTerm &t, int id) { return t.wordID < id; });
+        return it == last || it->wordID != wordID ? nullptr : &*it;
+    }
+
+    // A PositionSource for writeIndexImage
+    bool positions(int wordID, uint32_t doc, std::vector<uint32_t> &out) const
+    {
+        const SegmentTerm *it = find(wordID, doc);
+        if (!it)
+            return false;
+        out.resize(it->count);
+        decodeStream(PostingsCodec::VByte, positionBytes.data() + it->offset, it->count, out.data());
+        for (size_t i = 1; i < out.size(); ++i)
+            out[i] += out[i - 1];
+        return true;
+    }
+
+    // A FieldFreqSource for writeIndexImage
+    bool fieldFreqs(int wordID, uint32_t doc, uint32_t *out) const
+    {
+        const SegmentTerm *it = find(wordID, doc);
+        if (!it)
+            return false;
+        std::copy(it->fieldFreqs, it->fieldFreqs + SCORED_FIELDS, out);
+        return true;
+    }
+};
+
+// Splits a CSV line into fields, respecting quoted commas.
+std::vector<std::string> splitCSVLine(const std::string &line)
+{
+    std::vector<std::string> cols;
+    std::string cur;
+    bool inQuotes = false;
+    for (char c : line)
+    {
+        if (c == '"')
+            inQuotes = !inQuotes;
+        else if (c == ',' && !inQuotes)
+        {
+            cols.push_back(cur);
+            cur.clear();
+        }
+        else
+            cur.push_back(c);
+    }
+    cols.push_back(cur);
+    return cols;
+}
+
+void readMetadata(std::ifstream &meta, const std::unordered_set<std::string> &skipDocs,
+                  BoundedQueue<RawDoc> &out)
+{
+    std::string line;
+    getline(meta, line); // header
+
+    // Look columns up by name; fall back to the old fixed positions
+    auto header = splitCSVLine(line);
+    auto column = [&](const std::string &name, int fallback)
+    {
+        for (size_t i = 0; i < header.size(); ++i)
+            if (header[i] == name)
+                return (int)i;
+        return fallback;
+    };
+    const int idCol = column("cord_uid", 0);
+    const int titleCol = column("title", 2);
+    const int abstractCol = column("abstract", 8);
+    const int urlCol = column("url", -1);
+    const int authorsCol = column("authors", -1);
+
+    auto field = [](const std::vector<std::string> &cols, int i)
+    {
+        return (i >= 0 && i < (int)cols.size()) ? cols[i] : std::string();
+    };
+
+    long seq = 0;
+    while (getline(meta, line))
+    {
+        if (line.empty())
+            continue;
+
+        auto cols = splitCSVLine(line);
+
+        RawDoc doc;
+        doc.docID = field(cols, idCol);
+        doc.title = field(cols, titleCol);
+        doc.abstractText = field(cols, abstractCol);
+        doc.url = field(cols, urlCol);
+        doc.authors = field(cols, authorsCol);
+        if (doc.docID.empty() || skipDocs.count(doc.docID))
+            continue;
+
+        doc.seq = seq++;
+        out.push(std::move(doc));
+    }
+    out.close();
+}
+
+void loadBodies(const std::string &jsonFolder, BoundedQueue<RawDoc> &in, BoundedQueue<RawDoc> &out)
+{
+    // Only body_text[].text and section names; keys, spans and
+    // bibliography entries are not indexed.
+    BodyTextExtractor extractor;
+    RawDoc doc;
+    while (in.pop(doc))
+    {
+        std::string jsonPath = jsonFolder + doc.docID + ".json";
+        if (fs::exists(jsonPath))
+        {
+            if (!extractor.parseFile(jsonPath))
+                std::cerr << "Warning: malformed JSON in " << jsonPath << "\n";
+            extractor.appendBody(doc.body); // paragraphs read before any error
+        }
+        out.push(std::move(doc));
+    }
+    out.close();
+}
+
+void tokenizeDocs(bool normalize, BoundedQueue<RawDoc> &in, BoundedQueue<TokenizedDoc> &spare,
+                  BoundedQueue<TokenizedDoc> &out, AllocationCounts &allocations)
+{
+    // Per-worker scratch, reset between documents
+    TermTable table;
+    std::string normalized, lowered;
+    std::vector<std::string_view> words;
+    std::vector<int> tokenTerms; // term slot of each token, in order
+
+    RawDoc raw;
+    TokenizedDoc doc;
+    while (in.pop(raw))
+    {
+        uint64_t before = threadAllocations();
+        spare.tryPop(doc); // otherwise reuse whatever doc still holds
+
+        doc.seq = raw.seq;
+        doc.docID = std::move(raw.docID);
+        doc.url = std::move(raw.url);
+        doc.arena.reset();
+        doc.terms.clear();
+        table.clear();
+        tokenTerms.clear();
+
+        auto processText = [&](const std::string &text, int priority)
+        {
+            // The normalizer already splits tokens and keeps digits and
+            // symbols, so its output is only split on whitespace.
+            if (normalize)
+            {
+                TextNormalizer::normalize(text, normalized);
+                splitWhitespace(normalized, words);
+            }
+            else
+                tokenizeWords(text, lowered, words);
+            doc.fieldLengths[priority - 1] = (uint32_t)words.size();
+
+            for (std::string_view w : words)
+            {
+                bool added;
+                int term = table.findOrAdd(w, doc.terms, (int)doc.terms.size(), added);
+                if (added)
+                    doc.terms.push_back({doc.arena.copy(w), 0, priority, 0});
+                TermHits &h = doc.terms[term];
+                h.freq++;
+                h.fieldFreqs[priority - 1]++;
+                h.priority = std::min(h.priority, priority);
+                tokenTerms.push_back(term);
+            }
+        };
+
+        processText(raw.title, 1);
+        processText(raw.abstractText, 2);
+        processText(raw.body, 3);
+
+        // Group positions by term: each term gets a range sized by its
+        // freq, filled in token order so every range stays sorted.
+        uint32_t next = 0;
+        for (TermHits &h : doc.terms)
+        {
+            h.firstPosition = next;
+            next += h.freq;
+        }
+        doc.positions.resize(tokenTerms.size());
+        for (size_t pos = 0; pos < tokenTerms.size(); ++pos)
+            doc.positions[doc.terms[tokenTerms[pos]].firstPosition++] = (int)pos;
+        for (TermHits &h : doc.terms)
+            h.firstPosition -= h.freq;
+
+        doc.length = (int)tokenTerms.size();
+        doc.title = std::move(raw.title);
+        doc.authors = std::move(raw.authors);
+        doc.abstractText = std::move(raw.abstractText);
+
+        allocations.analyze += threadAllocations() - before;
+        out.push(std::move(doc));
+    }
+}
+
+// Runs on the calling thread. Documents arrive out of order from the
+// workers and are held until every earlier document has been written.
+int invert(Lexicon &lex, SpimiInverter &spimi, std::vector<DocInfo> &docTable,
+           SegmentContent *segment, BoundedQueue<TokenizedDoc> &in,
+           BoundedQueue<TokenizedDoc> &spare, AllocationCounts &allocations)
+{
+    // Out-of-order documents; only about one per worker at a time, so
+    // a linear scan finds the next one.
+    std::vector<TokenizedDoc> pending;
+    long nextSeq = 0;
+    int docCount = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    std::string key;
+    std::vector<int> wordIDs;
+    std::vector<uint32_t> gaps; // positions of one term, for the segment
+
+    auto findNext = [&]
+    {
+        for (size_t i = 0; i < pending.size(); ++i)
+            if (pending[i].seq == nextSeq)
+                return i;
+        return pending.size();
+    };
+
+    TokenizedDoc doc;
+    while (in.pop(doc))
+    {
+        pending.push_back(std::move(doc));
+
+        for (size_t next = findNext(); next < pending.size(); next = findNext())
+        {
+            uint64_t before = threadAllocations();
+            TokenizedDoc &d = pending[next];
+
+            // Terms are distinct, so their IDs double as the word set
+            wordIDs.clear();
+            for (auto &t : d.terms)
+            {
+                key.assign(t.word.data(), t.word.size());
+                int wid = lex.getWordID(key);
+                wordIDs.push_back(wid);
+                if (segment)
+                    segment->words.try_emplace(wid, key);
+            }
+
+            writeForwardIndex(d.docID, wordIDs);
+            uint32_t docNum = spimi.addDocument(d.docID);
+            docTable.push_back({d.docID, d.url, (uint32_t)d.length});
+            if (segment)
+            {
+                ImageDoc img;
+                img.fields[DOC_CORD_ID] = d.docID;
+                img.fields[DOC_URL] = std::move(d.url);
+                img.fields[DOC_TITLE] = std::move(d.title);
+                img.fields[DOC_AUTHORS] = std::move(d.authors);
+                img.fields[DOC_ABSTRACT] = std::move(d.abstractText);
+                img.length = (uint32_t)d.length;
+                std::copy(d.fieldLengths, d.fieldLengths + SCORED_FIELDS, img.fieldLengths);
+                segment->docs.push_back(std::move(img));
+            }
+            for (size_t i = 0; i < d.terms.size(); ++i)
+            {
+                const TermHits &t = d.terms[i];
+                writeInverted(wordIDs[i], d.docID, t.freq, t.priority,
+                              d.positions.data() + t.firstPosition, t.freq);
+                spimi.add(wordIDs[i], docNum, t.freq, t.priority);
+                if (segment)
+                    segment->addTerm(wordIDs[i], d.positions.data() + t.firstPosition, t.freq, t.fieldFreqs, gaps);
+            }
+            if (segment)
+                segment->endDoc();
+
+            spare.tryPush(d);
+            if (next + 1 != pending.size())
+                pending[next] = std::move(pending.back());
+            pending.pop_back();
+            allocations.emit += threadAllocations() - before;
+
+            ++nextSeq;
+            ++docCount;
+            if ((docCount & 127) == 0)
+            {
+                double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::cout << "Processed docs: " << docCount << " (" << (int)(docCount / secs) << " docs/s)\r" << std::flush;
+            }
+        }
+    }
+    return docCount;
+}
+
+bool writeSegment(const std::string &path, const std::string &binaryPostingsPath, SegmentContent &segment)
+{
+    std::ifstream post(binaryPostingsPath, std::ios::binary | std::ios::ate);
+    if (!post.is_open())
+        return false;
+    std::vector<uint8_t> postingsFile((size_t)post.tellg());
+    post.seekg(0);
+    post.read(reinterpret_cast<char *>(postingsFile.data()), postingsFile.size());
+
+    std::vector<std::pair<std::string, int>> lexicon;
+    lexicon.reserve(segment.words.size());
+    for (auto &w : segment.words)
+        lexicon.emplace_back(std::move(w.second), w.first);
+    return writeIndexImage(
+        path, std::move(lexicon), postingsFile, segment.docs,
+        [&](int wordID, uint32_t doc, std::vector<uint32_t> &out) { return segment.positions(wordID, doc, out); },
+        [&](int wordID, uint32_t doc, uint32_t *out) { return segment.fieldFreqs(wordID, doc, out); });
+}
+} // namespace
+
+int runIngestPipeline(Lexicon &lex, const IngestOptions &opt)
+{
+    std::ifstream meta(opt.metadataPath);
+    if (!meta.is_open())
+    {
+        std::cerr << "Cannot open metadata.csv at " << opt.metadataPath << "\n";
+        return -1;
+    }
+
+    int threads = opt.threads > 0 ? opt.threads : (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+
+    BoundedQueue<RawDoc> rows(opt.queueDepth);
+    BoundedQueue<RawDoc> loaded(opt.queueDepth);
+    BoundedQueue<TokenizedDoc> tokenized(opt.queueDepth);
+    BoundedQueue<TokenizedDoc> spare(opt.queueDepth + threads); // written docs, back to the workers
+    AllocationCounts allocations;
+
+    std::thread reader(readMetadata, std::ref(meta), std::cref(opt.skipDocs), std::ref(rows));
+    std::thread loader(loadBodies, std::cref(opt.jsonFolder), std::ref(rows), std::ref(loaded));
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back(tokenizeDocs, opt.normalize, std::ref(loaded), std::ref(spare),
+                             std::ref(tokenized), std::ref(allocations));
+
+    // Close the inverter's queue once the last worker is done
+    std::thread closer([&]
+                       {
+                           for (auto &w : workers)
+                               w.join();
+                           tokenized.close();
+                       });
+
+    SpimiInverter spimi("data/runs", opt.memoryLimitMB << 20);
+    std::vector<DocInfo> docTable;
+    SegmentContent segment;
+    bool writeSegmentImage = !opt.segmentPath.empty() && !opt.binaryPostingsPath.empty();
+    int docCount = invert(lex, spimi, docTable, writeSegmentImage ? &segment : nullptr, tokenized,
+                          spare, allocations);
+
+    reader.join();
+    loader.join();
+    closer.join();
+
+    std::cout << "\n";
+    if (docCount > 0)
+        std::cout << "Heap allocations per doc: tokenize " << (double)allocations.analyze / docCount
+                  << ", invert " << (double)allocations.emit / docCount << "\n";
+    spimi.finish(opt.postingsPath, opt.binaryPostingsPath, opt.codec);
+    if (!saveDocTable(opt.docTablePath, docTable))
+        std::cerr << "Cannot write " << opt.docTablePath << "\n";
+    if (writeSegmentImage && !writeSegment(opt.segmentPath, opt.binaryPostingsPath, segment))
+        std::cerr << "Cannot write segment " << opt.segmentPath << "\n";
+    return docCount;
+}
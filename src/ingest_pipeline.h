@@ -0,0 +1,40 @@
+#ifndef INGEST_PIPELINE_H
+#define INGEST_PIPELINE_H
+
+#include "lexicon.h"
+#include "postings_format.h"
+#include <string>
+#include <unordered_set>
+
+struct IngestOptions
+{
+    std::string metadataPath;
+    std::string jsonFolder;
+    int threads = 0;            // tokenize workers, 0 = one per core
+    size_t queueDepth = 64;     // documents buffered between two stages
+    bool normalize = false;     // run TextNormalizer before tokenizing
+    size_t memoryLimitMB = 256; // postings buffer before spilling a run
+    std::string postingsPath = "data/postings.csv";
+    std::string binaryPostingsPath = "data/postings.bin";
+    std::string docTablePath = "data/doc_table.csv";
+    PostingsCodec codec = PostingsCodec::VByte;
+    std::string segmentPath;                  // also write the run as an index image here
+    std::unordered_set<std::string> skipDocs; // cord_uids already indexed
+};
+
+// Staged indexer:
+//   metadata reader -> JSON body loader -> tokenize workers -> inverter
+// connected by bounded queues. Workers collect each document's terms
+// into their own fragment; the inverter merges fragments into lex in
+// metadata order, so word IDs are the same as a single-threaded run.
+// Postings are inverted in memory (SPIMI) and merged into postingsPath
+// and binaryPostingsPath. Documents get dense numbers in metadata order;
+// docTablePath maps them back to cord_id and URL. With segmentPath set,
+// the same postings plus title/authors/abstract are also packed into an
+// index image there, ready to be committed as a segment (segments.h).
+// Rows whose cord_uid is in skipDocs are not indexed again.
+// Returns the number of documents indexed, or -1 if metadata.csv
+// cannot be opened.
+int runIngestPipeline(Lexicon &lex, const IngestOptions &opt);
+
+#endif
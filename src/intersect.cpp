@@ -0,0 +1,121 @@
+#include "intersect.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+// Past this length ratio the shorter list is galloped through the
+// longer. Measured against the block merge, the crossover is about 32
+// for lists of up to a thousand docs and grows to about 128 from 4096
+// on, as galloping's probes start to miss the cache.
+size_t gallopRatio(size_t longer)
+{
+    return std::min<size_t>(std::max<size_t>(longer / 32, 32), 128);
+}
+
+inline int lowestBit(unsigned m)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return (int)i;
+#else
+    return __builtin_ctz(m);
+#endif
+}
+
+size_t intersectGalloping(const uint32_t *shorter, size_t ns, const uint32_t *longer, size_t nl, uint32_t *out)
+{
+    size_t k = 0, j = 0;
+    for (size_t i = 0; i < ns && j < nl; ++i)
+    {
+        uint32_t x = shorter[i];
+        if (longer[j] < x)
+        {
+            // Double the step until past x, then binary search the last step
+            size_t lo = j + 1, step = 1, hi = lo;
+            while (hi < nl && longer[hi] < x)
+            {
+                lo = hi + 1;
+                hi += step;
+                step *= 2;
+            }
+            j = std::lower_bound(longer + lo, longer + std::min(hi + 1, nl), x) - longer;
+        }
+        out[k] = x;
+        k += j < nl && longer[j] == x;
+    }
+    return k;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+// Compares every value of a's next 4 with every value of b's next 4
+const size_t LANES = 4;
+
+inline unsigned matchMask(const uint32_t *a, const uint32_t *b)
+{
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    __m128i eq = _mm_cmpeq_epi32(va, vb);
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+    return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq));
+}
+
+#endif
+} // namespace
+
+size_t intersectScalar(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out)
+{
+    // Branches, not a branch-free step: the first comparison is mostly
+    // predicted right, and the branch-free form was twice as slow
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb)
+    {
+        if (a[i] < b[j])
+            ++i;
+        else if (b[j] < a[i])
+            ++j;
+        else
+        {
+            out[k++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+size_t intersectSorted(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out)
+{
+    if (na > nb)
+    {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (na * gallopRatio(nb) < nb)
+        return intersectGalloping(a, na, b, nb, out);
+
+    size_t i = 0, j = 0, k = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    // A block whose last value is the smaller cannot match anything in
+    // the other list past the other's block, so it is done
+    while (i + LANES <= na && j + LANES <= nb)
+    {
+        for (unsigned m = matchMask(a + i, b + j); m != 0; m &= m - 1)
+            out[k++] = a[i + lowestBit(m)];
+        uint32_t lastA = a[i + LANES - 1], lastB = b[j + LANES - 1];
+        i += lastA <= lastB ? LANES : 0;
+        j += lastB <= lastA ? LANES : 0;
+    }
+#endif
+    return k + intersectScalar(a + i, na - i, b + j, nb - j, out + k);
+}
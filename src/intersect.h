@@ -0,0 +1,19 @@
+#ifndef INTERSECT_H
+#define INTERSECT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Writes the values in both a and b to out (room for min(na, nb)) and
+// returns how many. Both must be strictly increasing, as doc numbers in
+// a posting list are. Lists of similar length are merged 4 values at a
+// time with SSE2, comparing all 16 pairs by rotating one vector (an
+// 8 x 8 AVX2 version was no faster: it leaves longer scalar tails); when
+// one list is 32 to 128 times longer, depending on its length, each
+// value of the shorter one is galloped for in it instead.
+size_t intersectSorted(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+
+// A plain scalar merge; used for short tails and without SSE2.
+size_t intersectScalar(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+
+#endif
@@ -1,14 +1,15 @@
 #include "inverted_index.h"
+#include "barrel_writer.h"
+#include <charconv>
 #include <fstream>
-#include <filesystem>
-#include <unordered_map>
-#include <tuple>
+#include <sstream>
+#include <iostream>
+#include <unordered_set>
 
-namespace fs = std::filesystem;
-const int BARREL_SIZE = 1000;
-
-static int getBarrelID(int wordID) {
-    return wordID / BARREL_SIZE;
+// One pool for the whole run so barrel/hitlist files stay open.
+static BarrelWriterPool &barrelWriters() {
+    static BarrelWriterPool pool;
+    return pool;
 }
 
 void writeInverted(
@@ -16,53 +17,91 @@ void writeInverted(
     const std::string &docID,
     int freq,
     int priority,
-    const std::vector<int> &positions
+    const int *positions,
+    size_t positionCount
 ) {
-    int bid = getBarrelID(wordID);
-    std::string barrel = "data/barrels/barrel_" + std::to_string(bid) + ".csv";
-    std::string hit = "data/hitlists/hitlist_" + std::to_string(bid) + ".csv";
-
-    std::ofstream b(barrel, std::ios::app);
-    b << wordID << "," << docID << "," << freq << "\n";
+    barrelWriters().write(wordID, docID, freq, priority, positions, positionCount);
+}
 
-    std::ofstream h(hit, std::ios::app);
-    h << wordID << "," << docID << "," << freq << "," << priority << ",";
-    for (size_t i = 0; i < positions.size(); ++i) {
-        if (i) h << "|";
-        h << positions[i];
+bool validatePostings(const std::string &path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Cannot open " << path << "\n";
+        return false;
     }
-    h << "\n";
-}
 
-void buildPostings() {
-    std::ofstream out("data/postings.csv");
-    out << "wordID,docIDs,freqs,priorities,totalFreq\n";
+    std::unordered_set<int> seenWords;
+    long long lineNo = 1, problems = 0;
+    std::string line;
+    getline(in, line); // header
+
+    auto split = [](const std::string &s) {
+        std::vector<std::string> parts;
+        std::stringstream ss(s);
+        std::string p;
+        while (getline(ss, p, ';')) parts.push_back(p);
+        return parts;
+    };
+
+    // The whole field as a number; false if empty or malformed
+    auto parse = [](const std::string &s, auto &value) {
+        auto r = std::from_chars(s.data(), s.data() + s.size(), value);
+        return !s.empty() && r.ec == std::errc() && r.ptr == s.data() + s.size();
+    };
 
-    for (auto &e : fs::directory_iterator("data/hitlists")) {
-        std::unordered_map<int,std::vector<std::tuple<std::string,int,int>>> agg;
-        std::ifstream in(e.path());
-        std::string line;
-        while (getline(in, line)) {
-            std::stringstream ss(line);
-            int wid,freq,prio;
-            std::string doc;
-            ss >> wid; ss.ignore();
-            getline(ss, doc, ',');
-            ss >> freq; ss.ignore();
-            ss >> prio;
-            agg[wid].push_back({doc,freq,prio});
+    while (getline(in, line)) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        std::stringstream ss(line);
+        std::string wid, docs, freqs, prios, total;
+        getline(ss, wid, ',');
+        getline(ss, docs, ',');
+        getline(ss, freqs, ',');
+        getline(ss, prios, ',');
+        getline(ss, total, ',');
+
+        auto report = [&](const std::string &msg) {
+            if (problems < 20)
+                std::cerr << path << ":" << lineNo << ": word " << wid << ": " << msg << "\n";
+            ++problems;
+        };
+
+        int wordID;
+        if (!parse(wid, wordID))
+            report("malformed wordID");
+        else if (!seenWords.insert(wordID).second)
+            report("wordID listed more than once");
+
+        auto d = split(docs), f = split(freqs), p = split(prios);
+        if (d.size() != f.size() || d.size() != p.size()) {
+            report("docIDs/freqs/priorities have different lengths");
+            continue;
         }
 
-        for (auto &p : agg) {
-            int total = 0;
-            std::string docs,freqs,prios;
-            for (size_t i=0;i<p.second.size();++i) {
-                auto &[d,f,r]=p.second[i];
-                if(i){docs+=";";freqs+=";";prios+=";";}
-                docs+=d; freqs+=std::to_string(f); prios+=std::to_string(r);
-                total+=f;
+        std::unordered_set<std::string> seenDocs;
+        long long sum = 0, freq, totalFreq;
+        bool freqsOk = true;
+        for (size_t i = 0; i < d.size(); ++i) {
+            if (!seenDocs.insert(d[i]).second)
+                report("duplicate docID " + d[i]);
+            if (parse(f[i], freq)) {
+                sum += freq;
+            } else {
+                report("malformed freq \"" + f[i] + "\"");
+                freqsOk = false;
             }
-            out<<p.first<<","<<docs<<","<<freqs<<","<<prios<<","<<total<<"\n";
         }
+        if (total.empty())
+            continue;
+        if (!parse(total, totalFreq))
+            report("malformed totalFreq");
+        else if (freqsOk && sum != totalFreq)
+            report("totalFreq does not match sum of freqs");
     }
+
+    if (problems)
+        std::cerr << path << ": " << problems << " problem(s) found\n";
+    return problems == 0;
 }
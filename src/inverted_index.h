@@ -9,9 +9,12 @@ void writeInverted(
     const std::string &docID,
     int freq,
     int priority,
-    const std::vector<int> &positions
+    const int *positions,
+    size_t positionCount
 );
 
-void buildPostings();
+// Checks postings.csv for repeated wordIDs, repeated docIDs within a
+// word, and column/total mismatches. Problems go to stderr.
+bool validatePostings(const std::string &path = "data/postings.csv");
 
 #endif
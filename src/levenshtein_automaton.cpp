@@ -0,0 +1,128 @@
+#include "levenshtein_automaton.h"
+#include <algorithm>
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view query, uint32_t maxDistance)
+    : query(query), limit((uint8_t)std::min<uint32_t>(maxDistance + 1, 255))
+{
+}
+
+void LevenshteinAutomaton::start(uint8_t *row) const
+{
+    for (size_t j = 0; j <= query.size(); ++j)
+        row[j] = (uint8_t)std::min<size_t>(j, limit);
+}
+
+void LevenshteinAutomaton::step(const uint8_t *row, char c, uint8_t *next) const
+{
+    next[0] = std::min<uint8_t>(row[0] + 1, limit);
+    for (size_t j = 1; j <= query.size(); ++j)
+    {
+        int best = row[j - 1] + (query[j - 1] != c); // match or substitute
+        best = std::min(best, row[j] + 1);           // extra word character
+        best = std::min(best, next[j - 1] + 1);      // missing word character
+        next[j] = (uint8_t)std::min<int>(best, limit);
+    }
+}
+
+uint32_t LevenshteinAutomaton::lowerBound(const uint8_t *row) const
+{
+    return *std::min_element(row, row + query.size() + 1);
+}
+
+uint32_t LevenshteinAutomaton::prefixDistance(std::string_view word) const
+{
+    std::vector<uint8_t> row(rowSize()), next(rowSize());
+    start(row.data());
+    uint32_t best = distance(row.data());
+    for (char c : word)
+    {
+        if (lowerBound(row.data()) >= best)
+            break;
+        step(row.data(), c, next.data());
+        row.swap(next);
+        best = std::min(best, distance(row.data()));
+    }
+    return best;
+}
+
+namespace
+{
+struct TrieWalk
+{
+    const PrefixDictionary &dict;
+    const LevenshteinAutomaton &automaton;
+    size_t &budget;
+    std::vector<FuzzyRange> &out;
+    std::string prefix;
+    std::string word;
+    std::vector<uint8_t> rows; // the state at each depth of prefix
+
+    // Visits the children of the node for prefix, whose words are
+    // [first, last); best is the closest match on the way down.
+    bool children(uint32_t first, uint32_t last, uint32_t best)
+    {
+        size_t depth = prefix.size(), width = automaton.rowSize();
+        if (rows.size() < (depth + 2) * width)
+            rows.resize((depth + 2) * width);
+
+        uint32_t i = first;
+        while (i < last)
+        {
+            dict.word(i, word);
+            if (word.size() == depth)
+            {
+                ++i; // the prefix itself, which sorts first
+                continue;
+            }
+            if (budget == 0)
+                return false;
+            --budget;
+
+            char c = word[depth];
+            prefix.push_back(c);
+            uint32_t end = dict.prefixEnd(prefix, i);
+            uint8_t *row = &rows[(depth + 1) * width];
+            automaton.step(&rows[depth * width], c, row);
+
+            uint32_t childBest = best;
+            if (automaton.distance(row) < best)
+            {
+                childBest = automaton.distance(row);
+                out.push_back({i, end, childBest});
+            }
+            if (automaton.lowerBound(row) < childBest && !children(i, end, childBest))
+                return false;
+            prefix.pop_back();
+            i = end;
+        }
+        return true;
+    }
+};
+} // namespace
+
+bool fuzzyPrefixRanges(const PrefixDictionary &dict, const LevenshteinAutomaton &automaton,
+                       size_t exactPrefix, size_t &budget, std::vector<FuzzyRange> &out)
+{
+    exactPrefix = std::min(exactPrefix, automaton.text().size());
+    TrieWalk walk{dict, automaton, budget, out, automaton.text().substr(0, exactPrefix), {}, {}};
+    auto range = dict.prefixRange(walk.prefix);
+    if (range.first == range.second)
+        return true;
+
+    size_t width = automaton.rowSize();
+    walk.rows.resize((exactPrefix + 1) * width);
+    automaton.start(walk.rows.data());
+    for (size_t i = 0; i < exactPrefix; ++i)
+        automaton.step(&walk.rows[i * width], walk.prefix[i], &walk.rows[(i + 1) * width]);
+
+    // A query no longer than exactPrefix + maxDistance matches every
+    // word here already
+    const uint8_t *row = &walk.rows[exactPrefix * width];
+    uint32_t best = automaton.maxDistance() + 1;
+    if (automaton.distance(row) < best)
+    {
+        best = automaton.distance(row);
+        out.push_back({range.first, range.second, best});
+    }
+    return automaton.lowerBound(row) >= best || walk.children(range.first, range.second, best);
+}
@@ -0,0 +1,63 @@
+#ifndef LEVENSHTEIN_AUTOMATON_H
+#define LEVENSHTEIN_AUTOMATON_H
+
+#include "prefix_dictionary.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Accepts words that have a prefix within maxDistance edits (insert,
+// delete, substitute) of the query. The state after reading some word
+// characters is one row of the edit distance table, the distances from
+// that much of the word to every prefix of the query, with values above
+// maxDistance clamped to maxDistance + 1. Rows are the caller's arrays
+// of rowSize() bytes, so walking many words in lockstep does not
+// allocate per step.
+class LevenshteinAutomaton
+{
+private:
+    std::string query;
+    uint8_t limit; // maxDistance + 1, the clamp
+
+public:
+    LevenshteinAutomaton(std::string_view query, uint32_t maxDistance);
+
+    const std::string &text() const { return query; }
+    size_t rowSize() const { return query.size() + 1; }
+    uint32_t maxDistance() const { return limit - 1u; }
+
+    void start(uint8_t *row) const; // state for the empty word
+    void step(const uint8_t *row, char c, uint8_t *next) const;
+
+    // Edits from the word read so far to the whole query (maxDistance + 1
+    // if too many). No longer word through this state gets below
+    // lowerBound(), so a walk can stop once that reaches what it has.
+    uint32_t distance(const uint8_t *row) const { return row[query.size()]; }
+    uint32_t lowerBound(const uint8_t *row) const;
+
+    // Smallest distance() over the prefixes of word
+    uint32_t prefixDistance(std::string_view word) const;
+};
+
+// Words of a dictionary range whose best prefix is `distance` edits from
+// the query, or words under such a prefix that have a closer one.
+struct FuzzyRange
+{
+    uint32_t first, last;
+    uint32_t distance;
+};
+
+// Walks the dictionary as the trie its sorted words imply (a node is
+// the range of words sharing a prefix, its children the sub-ranges for
+// each next character) in lockstep with the automaton, from the node
+// for the query's first exactPrefix characters: typos are rare there,
+// and pinning them cuts the nodes within reach of 2 edits many times
+// over. Appends the range of every node whose prefix matches more
+// closely than any of its ancestors, and skips subtrees that cannot
+// match. Each node visited uses one unit of budget; returns false if it
+// ran out, leaving the ranges found so far.
+bool fuzzyPrefixRanges(const PrefixDictionary &dict, const LevenshteinAutomaton &automaton,
+                       size_t exactPrefix, size_t &budget, std::vector<FuzzyRange> &out);
+
+#endif
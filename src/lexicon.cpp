@@ -1,6 +1,6 @@
 #include "lexicon.h"
 #include <fstream>
-#include <sstream>
+#include <algorithm>
 
 void Lexicon::load(const std::string &path)
 {
@@ -13,14 +13,14 @@ void Lexicon::load(const std::string &path)
 
     while (getline(in, line))
     {
-        std::stringstream ss(line);
-        std::string w;
-        int id;
-        getline(ss, w, ',');
-        ss >> id;
+        // The word itself may contain commas; the ID is after the last one
+        size_t comma = line.rfind(',');
+        if (comma == std::string::npos)
+            continue;
+        std::string w = line.substr(0, comma);
+        int id = std::stoi(line.substr(comma + 1));
 
         wordToID[w] = id;
-        trie.insert(w); // ← ADD
         nextID = std::max(nextID, id + 1);
     }
 }
@@ -46,10 +46,6 @@ int Lexicon::getWordID(const std::string &word)
 bool Lexicon::contains(const std::string &word) const
 {
     return wordToID.count(word);
-}
-std::vector<std::string> Lexicon::autocomplete(const std::string &prefix, int k) const
-{
-    return trie.autocomplete(prefix, k);
 }
     int Lexicon::getExistingWordID(const std::string &word) const
     {
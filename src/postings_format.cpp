@@ -0,0 +1,302 @@
+#include "postings_format.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+const char MAGIC[4] = {'P', 'S', 'T', '2'};
+const uint64_t HEADER_BYTES = 4 + 4 * 3 + 8 * 2;
+
+uint64_t alignTo8(uint64_t n)
+{
+    return (n + 7) & ~uint64_t(7);
+}
+
+template <typename T>
+void writePod(std::ofstream &out, const T &v)
+{
+    out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+T readPod(const uint8_t *&p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return v;
+}
+
+void encodeVByte(const std::vector<uint32_t> &values, std::vector<uint8_t> &out)
+{
+    for (uint32_t v : values)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((uint8_t)v);
+    }
+}
+
+size_t decodeVByte(const uint8_t *in, size_t n, uint32_t *out)
+{
+    const uint8_t *p = in;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t v = *p & 0x7F;
+        int shift = 7;
+        while (*p++ & 0x80)
+        {
+            v |= (uint32_t)(*p & 0x7F) << shift;
+            shift += 7;
+        }
+        out[i] = v;
+    }
+    return p - in;
+}
+
+// Each block: one width byte, then count * width bits packed LSB first.
+void encodeBitPacked(const std::vector<uint32_t> &values, std::vector<uint8_t> &out)
+{
+    for (size_t start = 0; start < values.size(); start += BITPACK_BLOCK)
+    {
+        size_t count = std::min<size_t>(BITPACK_BLOCK, values.size() - start);
+        uint32_t maxV = 0;
+        for (size_t i = 0; i < count; ++i)
+            maxV |= values[start + i];
+        int width = 0;
+        while (width < 32 && (maxV >> width))
+            ++width;
+        out.push_back((uint8_t)width);
+
+        uint64_t acc = 0;
+        int bits = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            acc |= (uint64_t)values[start + i] << bits;
+            bits += width;
+            while (bits >= 8)
+            {
+                out.push_back((uint8_t)acc);
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits > 0)
+            out.push_back((uint8_t)acc);
+    }
+}
+
+size_t decodeBitPacked(const uint8_t *in, size_t n, uint32_t *out)
+{
+    const uint8_t *p = in;
+    for (size_t start = 0; start < n; start += BITPACK_BLOCK)
+    {
+        size_t count = std::min<size_t>(BITPACK_BLOCK, n - start);
+        int width = *p++;
+        uint64_t mask = width == 32 ? 0xFFFFFFFFull : ((1ull << width) - 1);
+
+        uint64_t acc = 0;
+        int bits = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            while (bits < width)
+            {
+                acc |= (uint64_t)(*p++) << bits;
+                bits += 8;
+            }
+            out[start + i] = (uint32_t)(acc & mask);
+            acc >>= width;
+            bits -= width;
+        }
+    }
+    return p - in;
+}
+} // namespace
+
+void encodeStream(PostingsCodec codec, const std::vector<uint32_t> &values, std::vector<uint8_t> &out)
+{
+    if (codec == PostingsCodec::BitPacked)
+        encodeBitPacked(values, out);
+    else
+        encodeVByte(values, out);
+}
+
+size_t decodeStream(PostingsCodec codec, const uint8_t *in, size_t n, uint32_t *out)
+{
+    if (codec == PostingsCodec::BitPacked)
+        return decodeBitPacked(in, n, out);
+    return decodeVByte(in, n, out);
+}
+
+// ============================================
+// WRITER
+// ============================================
+
+PostingsWriter::PostingsWriter(const std::string &path, PostingsCodec codec)
+    : out(path, std::ios::binary | std::ios::trunc), codec(codec)
+{
+    // Header is rewritten by finish() once the section offsets are known
+    out.write(MAGIC, 4);
+    writePod(out, (uint32_t)codec);
+    writePod(out, (uint32_t)0);
+    writePod(out, (uint32_t)0);
+    writePod(out, (uint64_t)0);
+    writePod(out, (uint64_t)0);
+}
+
+void PostingsWriter::addTerm(int wordID, const PostingList &list)
+{
+    TermEntry e{};
+    e.wordID = wordID;
+    e.df = (uint32_t)list.docs.size();
+    e.offset = dataBytes;
+
+    gaps.resize(list.docs.size());
+    for (size_t i = 0; i < list.docs.size(); ++i)
+        gaps[i] = i ? list.docs[i] - list.docs[i - 1] : list.docs[i];
+
+    scratch.clear();
+    encodeStream(codec, gaps, scratch);
+    e.docBytes = (uint32_t)scratch.size();
+    encodeStream(codec, list.freqs, scratch);
+    e.freqBytes = (uint32_t)scratch.size() - e.docBytes;
+    encodeStream(codec, list.fields, scratch);
+    e.fieldBytes = (uint32_t)scratch.size() - e.docBytes - e.freqBytes;
+
+    out.write(reinterpret_cast<const char *>(scratch.data()), scratch.size());
+    dataBytes += scratch.size();
+    terms.push_back(e);
+}
+
+void PostingsWriter::finish(const std::vector<std::string> &docIDs)
+{
+    const char zeros[8] = {};
+    uint64_t docsOffset = alignTo8(HEADER_BYTES + dataBytes);
+    out.write(zeros, docsOffset - HEADER_BYTES - dataBytes);
+
+    uint32_t nameBytes = 0;
+    writePod(out, nameBytes);
+    for (auto &d : docIDs)
+    {
+        nameBytes += (uint32_t)d.size();
+        writePod(out, nameBytes);
+    }
+    for (auto &d : docIDs)
+        out.write(d.data(), d.size());
+
+    uint64_t docsEnd = docsOffset + 4 * (docIDs.size() + 1) + nameBytes;
+    uint64_t termsOffset = alignTo8(docsEnd);
+    out.write(zeros, termsOffset - docsEnd);
+    out.write(reinterpret_cast<const char *>(terms.data()), terms.size() * sizeof(TermEntry));
+
+    out.seekp(4);
+    writePod(out, (uint32_t)codec);
+    writePod(out, (uint32_t)docIDs.size());
+    writePod(out, (uint32_t)terms.size());
+    writePod(out, docsOffset);
+    writePod(out, termsOffset);
+    out.close();
+}
+
+// ============================================
+// READER
+// ============================================
+
+bool PostingsReader::load(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open())
+        return false;
+
+    owned.resize((size_t)in.tellg());
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(owned.data()), owned.size());
+    return attach(owned.data(), owned.size());
+}
+
+bool PostingsReader::attach(const uint8_t *file, size_t size)
+{
+    if (size < HEADER_BYTES || std::memcmp(file, MAGIC, 4) != 0)
+        return false;
+
+    const uint8_t *p = file + 4;
+    PostingsCodec fileCodec = (PostingsCodec)readPod<uint32_t>(p);
+    uint32_t docCount = readPod<uint32_t>(p);
+    uint32_t termCount = readPod<uint32_t>(p);
+    uint64_t docsOffset = readPod<uint64_t>(p);
+    uint64_t termsOffset = readPod<uint64_t>(p);
+    if ((fileCodec != PostingsCodec::VByte && fileCodec != PostingsCodec::BitPacked) ||
+        docsOffset % 8 != 0 || termsOffset % 8 != 0 ||
+        docsOffset + 4 * ((uint64_t)docCount + 1) > size ||
+        termsOffset + (uint64_t)termCount * sizeof(TermEntry) > size)
+        return false;
+
+    // Every doc name must lie inside the file
+    const uint32_t *offsets = reinterpret_cast<const uint32_t *>(file + docsOffset);
+    if (docsOffset + 4 * ((uint64_t)docCount + 1) + offsets[docCount] > size)
+        return false;
+    for (uint32_t d = 0; d < docCount; ++d)
+        if (offsets[d] > offsets[d + 1])
+            return false;
+
+    codec = fileCodec;
+    data = file + HEADER_BYTES;
+    nameOffsets = offsets;
+    names = reinterpret_cast<const char *>(nameOffsets + docCount + 1);
+    terms = reinterpret_cast<const TermEntry *>(file + termsOffset);
+    numDocs = docCount;
+    numTerms = termCount;
+    return true;
+}
+
+const TermEntry *PostingsReader::find(int wordID) const
+{
+    const TermEntry *end = terms + numTerms;
+    const TermEntry *it = std::lower_bound(terms, end, wordID,
+                                           [](const TermEntry &e, int w)
+                                           { return e.wordID < w; });
+    if (it == end || it->wordID != wordID)
+        return nullptr;
+    return it;
+}
+
+uint32_t PostingsReader::docFrequency(int wordID) const
+{
+    const TermEntry *e = find(wordID);
+    return e ? e->df : 0;
+}
+
+void PostingsReader::readDocs(const TermEntry &e, std::vector<uint32_t> &docs) const
+{
+    docs.resize(e.df);
+    decodeStream(codec, data + e.offset, e.df, docs.data());
+    for (size_t i = 1; i < docs.size(); ++i)
+        docs[i] += docs[i - 1];
+}
+
+void PostingsReader::read(const TermEntry &e, PostingList &out) const
+{
+    readDocs(e, out.docs);
+    out.freqs.resize(e.df);
+    out.fields.resize(e.df);
+    const uint8_t *p = data + e.offset + e.docBytes;
+    decodeStream(codec, p, e.df, out.freqs.data());
+    decodeStream(codec, p + e.freqBytes, e.df, out.fields.data());
+}
+
+bool PostingsReader::read(int wordID, PostingList &out) const
+{
+    const TermEntry *e = find(wordID);
+    if (!e)
+    {
+        out.docs.clear();
+        out.freqs.clear();
+        out.fields.clear();
+        return false;
+    }
+    read(*e, out);
+    return true;
+}
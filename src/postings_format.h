@@ -0,0 +1,121 @@
+#ifndef POSTINGS_FORMAT_H
+#define POSTINGS_FORMAT_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary postings file (data/postings.bin), host byte order:
+//
+//   header  "PST2", codec, docCount, termCount, docsOffset, termsOffset
+//   data    per term: docID gaps | freqs | fields, each its own stream
+//   docs    u32 name offsets x (docCount + 1), then cord_id bytes
+//   terms   termCount x TermEntry, sorted by wordID
+//
+// DocIDs are dense doc numbers stored as gaps from the previous doc in
+// the list. The streams are separate so a reader can decode doc numbers
+// without touching freqs or fields. The docs and terms sections start on
+// 8-byte boundaries and hold fixed-width records, so a reader can use a
+// loaded or memory-mapped file in place.
+
+enum class PostingsCodec : uint32_t
+{
+    VByte = 0,     // 7 bits per byte, high bit = more bytes follow
+    BitPacked = 1, // 128-value blocks, one bit width per block
+};
+
+const int BITPACK_BLOCK = 128;
+
+void encodeStream(PostingsCodec codec, const std::vector<uint32_t> &values, std::vector<uint8_t> &out);
+
+// Decodes n values from in; returns the number of bytes consumed.
+size_t decodeStream(PostingsCodec codec, const uint8_t *in, size_t n, uint32_t *out);
+
+struct TermEntry
+{
+    int32_t wordID;
+    uint32_t df;         // number of documents
+    uint64_t offset;     // start of the doc stream, relative to the data section
+    uint32_t docBytes;   // doc-gap stream length
+    uint32_t freqBytes;  // freq stream length (follows the doc stream)
+    uint32_t fieldBytes; // field stream length (follows the freq stream)
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(TermEntry) == 32, "TermEntry is stored as-is in postings.bin");
+
+struct PostingList
+{
+    std::vector<uint32_t> docs;   // doc numbers, ascending
+    std::vector<uint32_t> freqs;  // term frequency per doc
+    std::vector<uint32_t> fields; // best field: 1=title, 2=abstract, 3=body
+};
+
+class PostingsWriter
+{
+private:
+    std::ofstream out;
+    PostingsCodec codec;
+    std::vector<TermEntry> terms;
+    uint64_t dataBytes = 0;
+    std::vector<uint8_t> scratch;
+    std::vector<uint32_t> gaps;
+
+public:
+    explicit PostingsWriter(const std::string &path, PostingsCodec codec = PostingsCodec::VByte);
+    bool isOpen() const { return out.is_open(); }
+
+    // Terms must be added in increasing wordID order.
+    void addTerm(int wordID, const PostingList &list);
+
+    // Writes the doc table and term directory; docIDs[n] is the cord_id
+    // of doc number n.
+    void finish(const std::vector<std::string> &docIDs);
+};
+
+// Reads postings straight out of the file bytes: load() keeps its own
+// copy of the file, attach() points at bytes owned by the caller (e.g. a
+// mapped index image), which must stay alive and be 8-byte aligned.
+class PostingsReader
+{
+private:
+    std::vector<uint8_t> owned;
+    PostingsCodec codec = PostingsCodec::VByte;
+    const uint8_t *data = nullptr;
+    const uint32_t *nameOffsets = nullptr;
+    const char *names = nullptr;
+    const TermEntry *terms = nullptr;
+    uint32_t numDocs = 0;
+    uint32_t numTerms = 0;
+
+public:
+    PostingsReader() = default;
+    PostingsReader(const PostingsReader &) = delete;
+    PostingsReader &operator=(const PostingsReader &) = delete;
+
+    bool load(const std::string &path);
+    bool attach(const uint8_t *file, size_t size);
+
+    PostingsCodec getCodec() const { return codec; }
+    size_t docCount() const { return numDocs; }
+    std::string_view docName(uint32_t doc) const
+    {
+        return std::string_view(names + nameOffsets[doc], nameOffsets[doc + 1] - nameOffsets[doc]);
+    }
+    size_t termCount() const { return numTerms; }
+    const TermEntry &entry(size_t i) const { return terms[i]; }
+
+    // Start of a term's doc stream; its freq stream follows at
+    // e.docBytes. For decoding part of a list with decodeStream.
+    const uint8_t *termData(const TermEntry &e) const { return data + e.offset; }
+
+    const TermEntry *find(int wordID) const;
+    uint32_t docFrequency(int wordID) const;
+
+    bool read(int wordID, PostingList &out) const;
+    void read(const TermEntry &e, PostingList &out) const;
+    void readDocs(const TermEntry &e, std::vector<uint32_t> &docs) const;
+};
+
+#endif
@@ -0,0 +1,327 @@
+#include "prefix_dictionary.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+struct DictionaryHeader
+{
+    uint32_t wordCount;
+    uint32_t blockCount;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t dataBytes;
+};
+
+uint32_t floorLog2(uint32_t n)
+{
+    uint32_t log = 0;
+    while (n >>= 1)
+        ++log;
+    return log;
+}
+
+template <typename T>
+void appendPod(std::vector<uint8_t> &out, const T &v)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+void appendVByte(std::vector<uint8_t> &out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+uint32_t readVByte(const uint8_t *&p)
+{
+    uint32_t v = *p & 0x7F;
+    int shift = 7;
+    while (*p++ & 0x80)
+    {
+        v |= (uint32_t)(*p & 0x7F) << shift;
+        shift += 7;
+    }
+    return v;
+}
+
+// Applies one front-coded entry to the previous word
+void readEntry(const uint8_t *&p, std::string &word)
+{
+    uint32_t shared = readVByte(p);
+    uint32_t suffix = readVByte(p);
+    word.resize(shared);
+    word.append(reinterpret_cast<const char *>(p), suffix);
+    p += suffix;
+}
+
+size_t sharedPrefix(const std::string &a, const std::string &b)
+{
+    size_t n = 0;
+    while (n < a.size() && n < b.size() && a[n] == b[n])
+        ++n;
+    return n;
+}
+
+// Whether word sorts before key; with pastPrefix, words starting with
+// key count as before it too, which finds the end of the key's range.
+bool before(std::string_view word, std::string_view key, bool pastPrefix)
+{
+    if (pastPrefix && word.compare(0, key.size(), key) == 0)
+        return true;
+    return word < key;
+}
+} // namespace
+
+void PrefixDictionary::write(const std::vector<std::string> &words, const std::vector<uint32_t> &weights,
+                             std::vector<uint8_t> &out)
+{
+    DictionaryHeader header{};
+    header.wordCount = (uint32_t)words.size();
+    header.blockCount = (header.wordCount + BLOCK_WORDS - 1) / BLOCK_WORDS;
+    header.levelCount = header.blockCount ? floorLog2(header.blockCount) + 1 : 0;
+
+    // Heaviest word per block, then per run of 2^level blocks
+    auto heavier = [&](uint32_t a, uint32_t b)
+    {
+        return weights[a] > weights[b] || (weights[a] == weights[b] && a < b) ? a : b;
+    };
+    std::vector<uint32_t> maxima(header.levelCount * header.blockCount);
+    for (uint32_t i = 0; i < header.wordCount; ++i)
+    {
+        uint32_t &best = maxima[i / BLOCK_WORDS];
+        best = i % BLOCK_WORDS == 0 ? i : heavier(best, i);
+    }
+    for (uint32_t level = 1; level < header.levelCount; ++level)
+    {
+        const uint32_t *below = &maxima[(level - 1) * header.blockCount];
+        uint32_t *row = &maxima[level * header.blockCount];
+        uint32_t half = 1u << (level - 1);
+        for (uint32_t i = 0; i < header.blockCount; ++i)
+            row[i] = i + half < header.blockCount ? heavier(below[i], below[i + half]) : below[i];
+    }
+
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> offsets;
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        const std::string &w = words[i];
+        if (i % BLOCK_WORDS == 0)
+        {
+            offsets.push_back((uint32_t)bytes.size());
+            appendVByte(bytes, (uint32_t)w.size());
+            bytes.insert(bytes.end(), w.begin(), w.end());
+            continue;
+        }
+        size_t shared = sharedPrefix(words[i - 1], w);
+        appendVByte(bytes, (uint32_t)shared);
+        appendVByte(bytes, (uint32_t)(w.size() - shared));
+        bytes.insert(bytes.end(), w.begin() + shared, w.end());
+    }
+    offsets.push_back((uint32_t)bytes.size());
+    header.dataBytes = bytes.size();
+
+    appendPod(out, header);
+    for (uint32_t o : offsets)
+        appendPod(out, o);
+    for (uint32_t w : weights)
+        appendPod(out, w);
+    for (uint32_t m : maxima)
+        appendPod(out, m);
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+bool PrefixDictionary::attach(const uint8_t *section, size_t size)
+{
+    DictionaryHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, section, sizeof(header));
+
+    uint64_t weightsOffset = sizeof(header) + 4ull * (header.blockCount + 1);
+    uint64_t maximaOffset = weightsOffset + 4ull * header.wordCount;
+    uint64_t dataOffset = maximaOffset + 4ull * header.levelCount * header.blockCount;
+    if (dataOffset + header.dataBytes > size ||
+        header.blockCount != (header.wordCount + BLOCK_WORDS - 1) / BLOCK_WORDS ||
+        header.levelCount != (header.blockCount ? floorLog2(header.blockCount) + 1 : 0))
+        return false;
+
+    blockOffsets = reinterpret_cast<const uint32_t *>(section + sizeof(header));
+    weights = reinterpret_cast<const uint32_t *>(section + weightsOffset);
+    maxima = reinterpret_cast<const uint32_t *>(section + maximaOffset);
+    data = section + dataOffset;
+    numWords = header.wordCount;
+    numBlocks = header.blockCount;
+    numLevels = header.levelCount;
+    return blockOffsets[numBlocks] == header.dataBytes;
+}
+
+std::string_view PrefixDictionary::blockHead(uint32_t block) const
+{
+    const uint8_t *p = data + blockOffsets[block];
+    uint32_t length = readVByte(p);
+    return std::string_view(reinterpret_cast<const char *>(p), length);
+}
+
+// First word index for which before(word, key, pastPrefix) is false,
+// given that every word in blocks before `from` comes before the key.
+// From a later block the search gallops, so when the answer is near
+// `from` it costs only a few head comparisons.
+uint32_t PrefixDictionary::bound(std::string_view key, bool pastPrefix, uint32_t from) const
+{
+    // Find the blocks whose head comes before the key: all of [0, lo)
+    uint32_t lo = from, hi = numBlocks;
+    if (from > 0)
+    {
+        uint32_t step = 1;
+        while (from + step < numBlocks && before(blockHead(from + step), key, pastPrefix))
+        {
+            lo = from + step;
+            step *= 2;
+        }
+        hi = std::min(from + step, numBlocks);
+    }
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (before(blockHead(mid), key, pastPrefix))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == from)
+        return from * BLOCK_WORDS;
+
+    // The answer is inside the last such block or right after it
+    Cursor cursor(*this, (lo - 1) * BLOCK_WORDS);
+    for (uint32_t i = 0; i < BLOCK_WORDS && cursor.next(); ++i)
+        if (!before(cursor.word(), key, pastPrefix))
+            return cursor.wordIndex();
+    return std::min(lo * BLOCK_WORDS, numWords);
+}
+
+std::pair<uint32_t, uint32_t> PrefixDictionary::prefixRange(std::string_view prefix) const
+{
+    uint32_t first = bound(prefix, false, 0);
+    return {first, prefixEnd(prefix, first)};
+}
+
+uint32_t PrefixDictionary::prefixEnd(std::string_view prefix, uint32_t first) const
+{
+    return bound(prefix, true, first / BLOCK_WORDS);
+}
+
+void PrefixDictionary::word(uint32_t index, std::string &out) const
+{
+    Cursor cursor(*this, index);
+    if (cursor.next())
+        out = cursor.word();
+    else
+        out.clear();
+}
+
+uint32_t PrefixDictionary::heavier(uint32_t a, uint32_t b) const
+{
+    return weights[a] > weights[b] || (weights[a] == weights[b] && a < b) ? a : b;
+}
+
+uint32_t PrefixDictionary::heaviest(uint32_t first, uint32_t last) const
+{
+    uint32_t firstBlock = first / BLOCK_WORDS, lastBlock = (last - 1) / BLOCK_WORDS;
+    uint32_t best = first;
+    if (firstBlock == lastBlock)
+    {
+        for (uint32_t i = first + 1; i < last; ++i)
+            best = heavier(best, i);
+        return best;
+    }
+
+    // Partial blocks at both ends, whole blocks in between from two
+    // overlapping runs of the maxima table
+    for (uint32_t i = first + 1; i < (firstBlock + 1) * BLOCK_WORDS; ++i)
+        best = heavier(best, i);
+    for (uint32_t i = lastBlock * BLOCK_WORDS; i < last; ++i)
+        best = heavier(best, i);
+    uint32_t from = firstBlock + 1, count = lastBlock - from;
+    if (count > 0)
+    {
+        uint32_t level = floorLog2(count);
+        const uint32_t *row = maxima + (size_t)level * numBlocks;
+        best = heavier(best, row[from]);
+        best = heavier(best, row[lastBlock - (1u << level)]);
+    }
+    return best;
+}
+
+PrefixDictionary::Cursor::Cursor(const PrefixDictionary &dict, uint32_t index)
+    : dict(&dict), index(index)
+{
+}
+
+bool PrefixDictionary::Cursor::next()
+{
+    if (index >= dict->numWords)
+        return false;
+
+    uint32_t inBlock = index % BLOCK_WORDS;
+    if (!p || inBlock == 0)
+    {
+        // Start from the head of this word's block
+        p = dict->data + dict->blockOffsets[index / BLOCK_WORDS];
+        uint32_t length = readVByte(p);
+        current.assign(reinterpret_cast<const char *>(p), length);
+        p += length;
+        for (uint32_t i = 0; i < inBlock; ++i)
+            readEntry(p, current);
+    }
+    else
+        readEntry(p, current);
+    ++index;
+    return true;
+}
+
+PrefixDictionary::TopCursor::TopCursor(const PrefixDictionary &dict, std::pair<uint32_t, uint32_t> range)
+    : dict(&dict)
+{
+    push(range.first, range.second);
+}
+
+bool PrefixDictionary::TopCursor::lighter(const Range &a, const Range &b) const
+{
+    return dict->heavier(a.best, b.best) == b.best;
+}
+
+void PrefixDictionary::TopCursor::push(uint32_t first, uint32_t last)
+{
+    if (first >= last)
+        return;
+    heap.push_back({first, last, dict->heaviest(first, last)});
+    std::push_heap(heap.begin(), heap.end(), [this](const Range &a, const Range &b)
+                   { return lighter(a, b); });
+}
+
+bool PrefixDictionary::TopCursor::next(uint32_t &index)
+{
+    if (heap.empty())
+        return false;
+    std::pop_heap(heap.begin(), heap.end(), [this](const Range &a, const Range &b)
+                  { return lighter(a, b); });
+    Range r = heap.back();
+    heap.pop_back();
+
+    // The rest of the range is what lies on either side of its best word
+    index = r.best;
+    push(r.first, r.best);
+    push(r.best + 1, r.last);
+    return true;
+}
+
+uint32_t PrefixDictionary::TopCursor::nextWeight() const
+{
+    return heap.empty() ? 0 : dict->weights[heap.front().best];
+}
@@ -0,0 +1,111 @@
+#ifndef PREFIX_DICTIONARY_H
+#define PREFIX_DICTIONARY_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Sorted, front-coded word list for prefix completion, stored as one
+// flat section (host byte order) and used in place:
+//
+//   header   wordCount, blockCount, levelCount, data size
+//   blocks   uint32 x (blockCount + 1), offset of each block in data
+//   weights  uint32 x wordCount, a ranking weight per word (its df)
+//   maxima   uint32 x (levelCount * blockCount): entry i of level j is
+//            the heaviest word in blocks [i, i + 2^j)
+//   data     per block: the first word as vbyte length + bytes, then
+//            for each following word vbyte shared-prefix length,
+//            vbyte suffix length, suffix bytes
+//
+// Words sharing a prefix form one contiguous range. A prefix is found
+// by binary search over the block heads plus a scan of one block, and
+// the range is read back by decoding forward; no per-word pointers or
+// nodes are stored. The maxima table gives the heaviest word of any
+// range from two table reads and two partial block scans, so the k
+// heaviest completions cost O(k log k) whatever the range size.
+class PrefixDictionary
+{
+private:
+    const uint32_t *blockOffsets = nullptr;
+    const uint32_t *weights = nullptr;
+    const uint32_t *maxima = nullptr;
+    const uint8_t *data = nullptr;
+    uint32_t numWords = 0;
+    uint32_t numBlocks = 0;
+    uint32_t numLevels = 0;
+
+    std::string_view blockHead(uint32_t block) const;
+    uint32_t bound(std::string_view key, bool pastPrefix, uint32_t from) const;
+    uint32_t heavier(uint32_t a, uint32_t b) const;
+
+public:
+    static const uint32_t BLOCK_WORDS = 8;
+
+    // Appends the section for words, which must be sorted and distinct;
+    // weights[i] ranks words[i].
+    static void write(const std::vector<std::string> &words, const std::vector<uint32_t> &weights,
+                      std::vector<uint8_t> &out);
+
+    // The bytes must stay valid while the dictionary is used.
+    bool attach(const uint8_t *section, size_t size);
+
+    size_t size() const { return numWords; }
+    uint32_t weight(uint32_t index) const { return weights[index]; }
+    void word(uint32_t index, std::string &out) const;
+
+    // [first, last) word indexes starting with prefix
+    std::pair<uint32_t, uint32_t> prefixRange(std::string_view prefix) const;
+
+    // End of the words starting with prefix when they start at index
+    // first; cheap when the range is short, so a walk can step through
+    // sibling ranges one after another.
+    uint32_t prefixEnd(std::string_view prefix, uint32_t first) const;
+
+    // Heaviest word in [first, last), the alphabetically first on ties;
+    // the range must not be empty.
+    uint32_t heaviest(uint32_t first, uint32_t last) const;
+
+    // Decodes words in order from a given index.
+    class Cursor
+    {
+    private:
+        const PrefixDictionary *dict;
+        uint32_t index;
+        const uint8_t *p = nullptr;
+        std::string current;
+
+    public:
+        Cursor(const PrefixDictionary &dict, uint32_t index);
+        bool next(); // false past the last word
+        uint32_t wordIndex() const { return index - 1; }
+        const std::string &word() const { return current; }
+    };
+
+    // Lists the words of a range heaviest first (best-first search over
+    // subranges). Each step costs one heaviest() and a heap operation.
+    class TopCursor
+    {
+    private:
+        struct Range
+        {
+            uint32_t first, last, best;
+        };
+
+        const PrefixDictionary *dict;
+        std::vector<Range> heap;
+
+        bool lighter(const Range &a, const Range &b) const;
+        void push(uint32_t first, uint32_t last);
+
+    public:
+        TopCursor(const PrefixDictionary &dict, std::pair<uint32_t, uint32_t> range);
+        bool next(uint32_t &index); // false once the range is exhausted
+
+        // Weight of the word next() would return, 0 when exhausted
+        uint32_t nextWeight() const;
+    };
+};
+
+#endif
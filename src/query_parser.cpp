@@ -0,0 +1,299 @@
+#include "query_parser.h"
+#include "tokenizer.h"
+#include <algorithm>
+
+namespace
+{
+struct Token
+{
+    enum Kind
+    {
+        WORDS,  // a chunk of text between spaces
+        QUOTED, // the text between quotes
+        AND,
+        OR,
+        NOT,
+        NEAR,
+        OPEN,
+        CLOSE
+    };
+
+    Kind kind;
+    std::string_view text;
+    uint32_t slop = 0; // QUOTED and NEAR
+};
+
+// Words allowed between phrase or NEAR operands; more is no different
+// from being far apart
+const uint32_t MAX_SLOP = 1000;
+
+// Reads the digits at the start of text into n (capped at MAX_SLOP);
+// returns how many there were
+size_t parseCount(std::string_view text, uint32_t &n)
+{
+    size_t i = 0;
+    n = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+        n = std::min<uint32_t>(n * 10 + (text[i] - '0'), MAX_SLOP);
+    return i;
+}
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Splits on whitespace, parentheses and quotes; true if any operator,
+// parenthesis or quote was seen
+bool lex(std::string_view query, std::vector<Token> &tokens)
+{
+    bool syntax = false;
+    size_t i = 0;
+    while (i < query.size())
+    {
+        char c = query[i];
+        if (isSpace(c))
+        {
+            ++i;
+        }
+        else if (c == '(' || c == ')')
+        {
+            tokens.push_back({c == '(' ? Token::OPEN : Token::CLOSE, query.substr(i, 1)});
+            syntax = true;
+            ++i;
+        }
+        else if (c == '"')
+        {
+            size_t end = query.find('"', i + 1);
+            if (end == std::string_view::npos)
+                end = query.size();
+            Token token{Token::QUOTED, query.substr(i + 1, end - i - 1)};
+            i = end + 1;
+            if (i < query.size() && query[i] == '~')
+            {
+                size_t digits = parseCount(query.substr(i + 1), token.slop);
+                if (digits > 0)
+                    i += 1 + digits;
+            }
+            tokens.push_back(token);
+            syntax = true;
+        }
+        else
+        {
+            size_t end = i;
+            while (end < query.size() && !isSpace(query[end]) && query[end] != '(' && query[end] != ')' &&
+                   query[end] != '"')
+                ++end;
+            std::string_view chunk = query.substr(i, end - i);
+            Token token{Token::WORDS, chunk};
+            uint32_t distance;
+            if (chunk == "AND")
+                token.kind = Token::AND;
+            else if (chunk == "OR")
+                token.kind = Token::OR;
+            else if (chunk == "NOT")
+                token.kind = Token::NOT;
+            else if (chunk == "NEAR")
+            {
+                token.kind = Token::NEAR;
+                token.slop = DEFAULT_NEAR;
+            }
+            else if (chunk.size() > 5 && chunk.substr(0, 5) == "NEAR/" &&
+                     parseCount(chunk.substr(5), distance) == chunk.size() - 5)
+            {
+                token.kind = Token::NEAR;
+                token.slop = distance;
+            }
+            syntax = syntax || token.kind != Token::WORDS;
+            tokens.push_back(token);
+            i = end;
+        }
+    }
+    return syntax;
+}
+
+bool isEmpty(const QueryNode &node)
+{
+    return node.kind == QueryNode::OR && node.children.empty();
+}
+
+class Parser
+{
+private:
+    const std::vector<Token> &tokens;
+    size_t pos = 0;
+    std::string lowered;
+    std::vector<std::string_view> words;
+
+    bool at(Token::Kind kind) const { return pos < tokens.size() && tokens[pos].kind == kind; }
+
+    bool atOperand() const { return at(Token::WORDS) || at(Token::QUOTED) || at(Token::OPEN) || at(Token::NOT); }
+
+    // A TERM, a PHRASE of several words, or empty if text has none
+    QueryNode wordsNode(std::string_view text, uint32_t slop)
+    {
+        tokenizeWords(text, lowered, words);
+        QueryNode node;
+        if (words.size() == 1)
+        {
+            node.kind = QueryNode::TERM;
+            node.word = std::string(words[0]);
+        }
+        else if (words.size() > 1)
+        {
+            node.kind = QueryNode::PHRASE;
+            node.slop = slop;
+            for (std::string_view w : words)
+                node.children.push_back({QueryNode::TERM, std::string(w), {}});
+        }
+        return node;
+    }
+
+    QueryNode primary()
+    {
+        const Token &token = tokens[pos++];
+        if (token.kind != Token::OPEN)
+            return wordsNode(token.text, token.slop);
+        QueryNode node = orGroup(true);
+        if (at(Token::CLOSE))
+            ++pos;
+        return node;
+    }
+
+    QueryNode unary()
+    {
+        if (!at(Token::NOT))
+            return primary();
+        ++pos;
+        if (!atOperand())
+            return QueryNode(); // dangling
+        QueryNode operand = unary();
+        if (operand.kind == QueryNode::NOT)
+            return std::move(operand.children[0]); // NOT NOT a is a
+        if (isEmpty(operand))
+            return operand;
+        QueryNode node;
+        node.kind = QueryNode::NOT;
+        node.children.push_back(std::move(operand));
+        return node;
+    }
+
+    QueryNode nearGroup()
+    {
+        QueryNode node;
+        node.kind = QueryNode::NEAR;
+        while (true)
+        {
+            QueryNode operand = unary();
+            if (!isEmpty(operand))
+                node.children.push_back(std::move(operand));
+            if (!at(Token::NEAR))
+                break;
+            node.slop = std::max(node.slop, tokens[pos].slop);
+            ++pos;
+            if (!atOperand())
+                break; // dangling
+        }
+        if (node.children.empty())
+            return QueryNode();
+        if (node.children.size() == 1)
+            return std::move(node.children[0]);
+        for (const QueryNode &child : node.children)
+            if (child.kind != QueryNode::TERM && child.kind != QueryNode::PHRASE)
+            {
+                node.kind = QueryNode::AND; // no positions to be near
+                node.slop = 0;
+            }
+        return node;
+    }
+
+    QueryNode andGroup()
+    {
+        QueryNode node;
+        node.kind = QueryNode::AND;
+        while (true)
+        {
+            QueryNode operand = nearGroup();
+            if (!isEmpty(operand))
+                node.children.push_back(std::move(operand));
+            if (!at(Token::AND))
+                break;
+            ++pos;
+            if (!atOperand())
+                break; // dangling
+        }
+        if (node.children.empty())
+            return QueryNode();
+        if (node.children.size() == 1)
+            return std::move(node.children[0]);
+        return node;
+    }
+
+public:
+    explicit Parser(const std::vector<Token> &tokens) : tokens(tokens) {}
+
+    // Up to a ")" if nested, else to the end, skipping stray ones
+    QueryNode orGroup(bool nested)
+    {
+        QueryNode positive, negative;
+        positive.kind = QueryNode::OR;
+        negative.kind = QueryNode::AND;
+        while (pos < tokens.size())
+        {
+            if (at(Token::CLOSE))
+            {
+                if (nested)
+                    break;
+                ++pos;
+                continue;
+            }
+            if (at(Token::OR) || at(Token::AND) || at(Token::NEAR))
+            {
+                ++pos; // explicit OR, or an AND or NEAR with nothing before it
+                continue;
+            }
+            QueryNode operand = andGroup();
+            if (isEmpty(operand))
+                continue;
+            (operand.kind == QueryNode::NOT ? negative : positive).children.push_back(std::move(operand));
+        }
+
+        if (positive.children.size() == 1)
+            positive = QueryNode(std::move(positive.children[0]));
+        if (negative.children.empty())
+            return positive;
+        if (!isEmpty(positive))
+            negative.children.insert(negative.children.begin(), std::move(positive));
+        return negative;
+    }
+};
+
+void collectPositive(const QueryNode &node, std::vector<std::string> &out)
+{
+    if (node.kind == QueryNode::NOT)
+        return;
+    if (node.kind == QueryNode::TERM)
+    {
+        if (std::find(out.begin(), out.end(), node.word) == out.end())
+            out.push_back(node.word);
+        return;
+    }
+    for (const QueryNode &child : node.children)
+        collectPositive(child, out);
+}
+} // namespace
+
+bool parseQuery(std::string_view query, QueryNode &out)
+{
+    std::vector<Token> tokens;
+    bool syntax = lex(query, tokens);
+    Parser parser(tokens);
+    out = parser.orGroup(false);
+    return syntax;
+}
+
+void positiveWords(const QueryNode &node, std::vector<std::string> &out)
+{
+    out.clear();
+    collectPositive(node, out);
+}
@@ -0,0 +1,60 @@
+#ifndef QUERY_PARSER_H
+#define QUERY_PARSER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A parsed boolean query. Words are lowercased letter runs, as
+// tokenizeWords makes them.
+struct QueryNode
+{
+    enum Kind
+    {
+        TERM,   // word
+        PHRASE, // children are TERMs, in order, at most slop other words among them
+        NEAR,   // children are TERMs and PHRASEs, in any order, at most slop other words among them
+        AND,
+        OR,
+        NOT // one child; excludes it from the enclosing AND
+    };
+
+    Kind kind = OR;
+    std::string word;
+    std::vector<QueryNode> children;
+    uint32_t slop = 0; // PHRASE and NEAR
+};
+
+// Words a NEAR allows among its operands when none is given
+const uint32_t DEFAULT_NEAR = 5;
+
+// Parses
+//
+//   query    := or
+//   or       := and { ["OR"] and }      adjacent operands are ORed
+//   and      := near { "AND" near }
+//   near     := unary { ("NEAR" | "NEAR/" n) unary }
+//   unary    := "NOT" unary | primary
+//   primary  := "(" or ")" | '"' words '"' ["~" n] | word
+//
+// Operators are only recognised in capitals, so "not" stays a word. A
+// quoted phrase matches its words next to each other and in order, or
+// with "~n" with at most n other words among them. "a NEAR/n b" matches
+// a and b in either order with at most n other words between them
+// (DEFAULT_NEAR without "/n"); a chain of NEARs is one NEAR over all of
+// its operands, allowing the largest n. NEAR takes words and phrases; with
+// any other operand it is an AND. A
+// NOT operand of an OR group is moved out of it: "a b NOT c" is
+// (a OR b) AND NOT c. A chunk that tokenizes to several words
+// ("sars-cov") is a phrase, like a quoted one. Malformed input is
+// repaired rather than rejected: a missing ")" or '"' is assumed at the
+// end and dangling operators are dropped. Returns true if the query used
+// any operator, parenthesis or quote; a plain list of words is an OR of
+// its words either way.
+bool parseQuery(std::string_view query, QueryNode &out);
+
+// Distinct words outside NOT, in query order: the words that score.
+void positiveWords(const QueryNode &node, std::vector<std::string> &out);
+
+#endif
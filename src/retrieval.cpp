@@ -0,0 +1,787 @@
+#include "retrieval.h"
+#include "query_parser.h"
+#include "term_cursor.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace
+{
+// Bounds are summed in another order than real scores; this keeps a
+// rounding difference from pruning a doc that scores exactly its bound
+const double BOUND_SLACK = 1.0 + 1e-9;
+
+// Keeps the best k in a min-heap (by ranksBefore) in out: front() is
+// the one a new doc has to beat
+void keepBest(std::vector<ScoredDoc> &out, size_t k, const ScoredDoc &candidate)
+{
+    if (out.size() < k)
+    {
+        out.push_back(candidate);
+        std::push_heap(out.begin(), out.end(), ranksBefore);
+    }
+    else if (ranksBefore(candidate, out.front()))
+    {
+        std::pop_heap(out.begin(), out.end(), ranksBefore);
+        out.back() = candidate;
+        std::push_heap(out.begin(), out.end(), ranksBefore);
+    }
+}
+
+double coordinated(double score, int matched, int termCount)
+{
+    double coordFactor = termCount > 0 ? (double)matched / termCount : 1.0;
+    return score * (0.5 + 0.5 * coordFactor);
+}
+// What a matching doc scores on: the score of each positive query word
+// whose clause matched it
+struct Hits
+{
+    std::vector<bool> matched;
+    std::vector<double> scores;
+};
+
+// Words start..end of a doc, by token position
+struct Span
+{
+    uint32_t start;
+    uint32_t end;
+};
+
+// A set of doc numbers, walked in order like a TermCursor
+class DocSet
+{
+public:
+    virtual ~DocSet() = default;
+    virtual uint32_t doc() const = 0;
+    virtual void next() = 0;
+    virtual void seek(uint32_t target) = 0; // to the first doc >= target
+    virtual uint64_t cost() const = 0;      // docs it may visit
+    // Records the words of the clauses that match doc, the current doc
+    virtual void collect(uint32_t doc, Hits &hits) = 0;
+    // Where a word or phrase occurs in the current doc, in order; false
+    // if that is not known (no positions in its segment, or not a word
+    // or phrase)
+    virtual bool spans(std::vector<Span> &) { return false; }
+};
+
+class TermSet : public DocSet
+{
+private:
+    TermCursor cursor;
+    const Bm25 &bm25;
+    int wordIndex; // in Hits, or -1 under a NOT
+    std::vector<uint32_t> positions;
+
+public:
+    TermSet(const SegmentedIndex &index, const std::string &word, const Bm25 &bm25, int wordIndex)
+        : cursor(index, word, bm25), bm25(bm25), wordIndex(wordIndex)
+    {
+    }
+
+    uint32_t doc() const override { return cursor.doc(); }
+    void next() override { cursor.next(); }
+    void seek(uint32_t target) override { cursor.seek(target); }
+    uint64_t cost() const override { return cursor.docFreq; }
+
+    void collect(uint32_t doc, Hits &hits) override
+    {
+        if (wordIndex < 0 || cursor.doc() != doc || hits.matched[wordIndex])
+            return;
+        hits.matched[wordIndex] = true;
+        hits.scores[wordIndex] = cursor.score(bm25);
+    }
+
+    bool spans(std::vector<Span> &out) override
+    {
+        if (!cursor.positions(positions))
+            return false;
+        out.clear();
+        for (uint32_t p : positions)
+            out.push_back({p, p});
+        return true;
+    }
+};
+
+class AllDocs : public DocSet
+{
+private:
+    uint32_t current = 0;
+    uint32_t end;
+
+public:
+    explicit AllDocs(uint32_t docCount) : current(docCount > 0 ? 0 : END_DOC), end(docCount) {}
+
+    uint32_t doc() const override { return current; }
+    void next() override { seek(current + 1); }
+    void seek(uint32_t target) override { current = target < end ? std::max(current, target) : END_DOC; }
+    uint64_t cost() const override { return end; }
+    void collect(uint32_t, Hits &) override {}
+};
+
+// Intersection, leapfrogging from the cheapest set: every other set
+// seeks to its doc, and any that overshoots proposes the next candidate.
+// A rare term thus moves a common term's cursor in long gallops, and the
+// common term's blocks in between are never decoded.
+class AndSet : public DocSet
+{
+private:
+    std::vector<std::unique_ptr<DocSet>> required; // cheapest first
+    std::vector<std::unique_ptr<DocSet>> excluded;
+    uint32_t current = 0;
+
+    void align(uint32_t target)
+    {
+        uint32_t candidate = target;
+        while (true)
+        {
+            required[0]->seek(candidate);
+            candidate = required[0]->doc();
+            if (candidate == END_DOC)
+                break;
+            bool agreed = true;
+            for (size_t i = 1; i < required.size() && agreed; ++i)
+            {
+                required[i]->seek(candidate);
+                if (required[i]->doc() != candidate)
+                {
+                    candidate = required[i]->doc();
+                    agreed = false;
+                }
+            }
+            if (!agreed)
+            {
+                if (candidate == END_DOC)
+                    break;
+                continue;
+            }
+            bool isExcluded = false;
+            for (auto &set : excluded)
+            {
+                set->seek(candidate);
+                isExcluded = isExcluded || set->doc() == candidate;
+            }
+            if (!isExcluded)
+                break;
+            ++candidate;
+        }
+        current = candidate;
+    }
+
+public:
+    AndSet(std::vector<std::unique_ptr<DocSet>> required, std::vector<std::unique_ptr<DocSet>> excluded)
+        : required(std::move(required)), excluded(std::move(excluded))
+    {
+        std::stable_sort(this->required.begin(), this->required.end(),
+                         [](const std::unique_ptr<DocSet> &a, const std::unique_ptr<DocSet> &b)
+                         { return a->cost() < b->cost(); });
+        align(0);
+    }
+
+    uint32_t doc() const override { return current; }
+    void next() override { align(current + 1); }
+    void seek(uint32_t target) override
+    {
+        if (target > current)
+            align(target);
+    }
+    uint64_t cost() const override { return required[0]->cost(); }
+
+    void collect(uint32_t doc, Hits &hits) override
+    {
+        if (current != doc)
+            return;
+        for (auto &set : required)
+            set->collect(doc, hits);
+    }
+};
+
+// Union: a min-heap of the sets by current doc
+class OrSet : public DocSet
+{
+private:
+    std::vector<std::unique_ptr<DocSet>> sets;
+    std::vector<DocSet *> heap; // sets not yet at END_DOC
+    uint64_t totalCost = 0;
+
+    static bool after(const DocSet *a, const DocSet *b) { return a->doc() > b->doc(); }
+
+    // Re-places the front set after it moved
+    void sift()
+    {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        if (heap.back()->doc() == END_DOC)
+            heap.pop_back();
+        else
+            std::push_heap(heap.begin(), heap.end(), after);
+    }
+
+public:
+    explicit OrSet(std::vector<std::unique_ptr<DocSet>> sets) : sets(std::move(sets))
+    {
+        for (auto &set : this->sets)
+        {
+            totalCost += set->cost();
+            if (set->doc() != END_DOC)
+                heap.push_back(set.get());
+        }
+        std::make_heap(heap.begin(), heap.end(), after);
+    }
+
+    uint32_t doc() const override { return heap.empty() ? END_DOC : heap.front()->doc(); }
+
+    void next() override
+    {
+        uint32_t doc = this->doc();
+        while (!heap.empty() && heap.front()->doc() == doc)
+        {
+            heap.front()->next();
+            sift();
+        }
+    }
+
+    void seek(uint32_t target) override
+    {
+        while (!heap.empty() && heap.front()->doc() < target)
+        {
+            heap.front()->seek(target);
+            sift();
+        }
+    }
+
+    uint64_t cost() const override { return totalCost; }
+
+    void collect(uint32_t doc, Hits &hits) override
+    {
+        for (auto &set : sets)
+            if (set->doc() == doc)
+                set->collect(doc, hits);
+    }
+};
+
+// A PHRASE or NEAR: an AndSet of its operands finds the docs that have
+// all of them, and only for those are the operands' positions read and
+// matched. A doc whose positions are not known (its segment has none)
+// is taken on the AND alone.
+class PositionalSet : public DocSet
+{
+private:
+    std::unique_ptr<DocSet> all;
+    std::vector<DocSet *> operands; // in query order
+    std::vector<uint32_t> lengths;    // words in each operand
+    std::vector<uint32_t> maxLengths; // longest span of each; a sloppy phrase's has its slop too
+    uint32_t totalLength = 0;
+    bool ordered; // PHRASE
+    uint32_t slop;
+    std::vector<std::vector<Span>> operandSpans;
+    std::vector<size_t> heads;
+    std::vector<uint32_t> candidates; // spans of each operand worth trying (matchAnyOrder)
+    std::vector<Span> chosen;
+    uint32_t bestEnd = 0;
+    uint32_t bestStart = 0;
+    std::vector<Span> matches; // in the current doc
+    bool known = false;        // matches are positions, not just an AND
+    uint32_t current = END_DOC;
+
+    // Other words in a window holding one span of every operand, no two
+    // of them overlapping
+    int64_t gap(uint32_t start, uint32_t end) const { return (int64_t)end - start + 1 - totalLength; }
+
+    // Each start, with the earliest following span of each next operand:
+    // that gives the start's shortest match. Later starts never need
+    // earlier spans, so each operand's position only moves forward. The
+    // spans follow each other, so never overlap.
+    void matchOrdered()
+    {
+        std::fill(heads.begin(), heads.end(), 0);
+        for (const Span &first : operandSpans[0])
+        {
+            uint32_t end = first.end;
+            for (size_t i = 1; i < operandSpans.size(); ++i)
+            {
+                const std::vector<Span> &list = operandSpans[i];
+                while (heads[i] < list.size() && list[heads[i]].start <= end)
+                    ++heads[i];
+                if (heads[i] == list.size())
+                    return; // and so for every later start
+                end = list[heads[i]].end;
+            }
+            if (gap(first.start, end) <= slop)
+                matches.push_back({first.start, end});
+        }
+    }
+
+    // Picks a span for operands i on, none overlapping those chosen, for
+    // the earliest end below bestEnd. An operand's spans end no earlier
+    // as they start later (a sloppy phrase's are the shortest from each
+    // start), and past its first candidates[i] from heads[i] one that
+    // does not overlap ends no later.
+    void place(size_t i, uint32_t end)
+    {
+        if (i == operandSpans.size())
+        {
+            bestEnd = end;
+            bestStart = UINT32_MAX;
+            for (const Span &span : chosen)
+                bestStart = std::min(bestStart, span.start);
+            return;
+        }
+        const std::vector<Span> &list = operandSpans[i];
+        size_t last = std::min<size_t>(list.size(), heads[i] + candidates[i]);
+        for (size_t k = heads[i]; k < last && list[k].end < bestEnd; ++k)
+        {
+            const Span &span = list[k];
+            bool overlaps = false;
+            for (const Span &other : chosen)
+                overlaps = overlaps || (span.start <= other.end && other.start <= span.end);
+            if (overlaps)
+                continue;
+            chosen.push_back(span);
+            place(i + 1, std::max(end, span.end));
+            chosen.pop_back();
+        }
+    }
+
+    // The shortest window from each span start on holding a span of
+    // every operand in any order, recorded at the start it really has.
+    // A word counts for one operand only: "a NEAR a" needs two a's.
+    // Usually the operands' first spans from the start do not overlap,
+    // and they are the answer.
+    void matchAnyOrder()
+    {
+        std::fill(heads.begin(), heads.end(), 0);
+        while (true)
+        {
+            uint32_t start = UINT32_MAX, end = 0;
+            bool disjoint = true;
+            for (size_t i = 0; i < operandSpans.size(); ++i)
+            {
+                const Span &span = operandSpans[i][heads[i]];
+                start = std::min(start, span.start);
+                end = std::max(end, span.end);
+                for (size_t j = 0; j < i; ++j)
+                {
+                    const Span &other = operandSpans[j][heads[j]];
+                    disjoint = disjoint && (span.start > other.end || other.start > span.end);
+                }
+            }
+            if (disjoint)
+            {
+                if (gap(start, end) <= slop)
+                    matches.push_back({start, end});
+            }
+            else
+            {
+                uint64_t limit = (uint64_t)start + totalLength - 1 + slop;
+                bestEnd = (uint32_t)std::min<uint64_t>(limit + 1, UINT32_MAX);
+                bestStart = UINT32_MAX;
+                chosen.clear();
+                place(0, 0);
+                if (bestEnd <= limit && bestStart == start)
+                    matches.push_back({start, bestEnd});
+            }
+
+            // On to the next start; past an operand's last span nothing
+            // later has all of them
+            for (size_t i = 0; i < operandSpans.size(); ++i)
+                if (operandSpans[i][heads[i]].start == start && ++heads[i] == operandSpans[i].size())
+                    return;
+        }
+    }
+
+    bool matchesHere()
+    {
+        matches.clear();
+        for (size_t i = 0; i < operands.size(); ++i)
+        {
+            known = operands[i]->spans(operandSpans[i]);
+            if (!known)
+                return true;
+            if (operandSpans[i].empty())
+                return false;
+        }
+        if (ordered)
+            matchOrdered();
+        else
+            matchAnyOrder();
+        return !matches.empty();
+    }
+
+    void find()
+    {
+        while (all->doc() != END_DOC && !matchesHere())
+            all->next();
+        current = all->doc();
+    }
+
+public:
+    PositionalSet(std::vector<std::unique_ptr<DocSet>> parts, std::vector<uint32_t> lengths,
+                  std::vector<uint32_t> maxLengths, bool ordered, uint32_t slop)
+        : lengths(std::move(lengths)), maxLengths(std::move(maxLengths)), ordered(ordered), slop(slop)
+    {
+        for (auto &part : parts)
+            operands.push_back(part.get());
+        for (uint32_t length : this->lengths)
+            totalLength += length;
+        // Spans of an operand start at different words, so a span of
+        // another operand overlaps at most the longest of each, less one,
+        // of this operand's spans
+        for (uint32_t length : this->maxLengths)
+        {
+            uint32_t blocked = 0;
+            for (uint32_t other : this->maxLengths)
+                blocked += length + other - 1;
+            candidates.push_back(1 + blocked - (2 * length - 1));
+        }
+        operandSpans.resize(operands.size());
+        heads.resize(operands.size());
+        all = std::make_unique<AndSet>(std::move(parts), std::vector<std::unique_ptr<DocSet>>());
+        find();
+    }
+
+    uint32_t doc() const override { return current; }
+    void next() override
+    {
+        all->next();
+        find();
+    }
+    void seek(uint32_t target) override
+    {
+        if (target <= current)
+            return;
+        all->seek(target);
+        find();
+    }
+    uint64_t cost() const override { return all->cost(); }
+
+    void collect(uint32_t doc, Hits &hits) override
+    {
+        if (current == doc)
+            all->collect(doc, hits);
+    }
+
+    bool spans(std::vector<Span> &out) override
+    {
+        out = matches;
+        return known;
+    }
+};
+
+// Positive words score; words under a NOT only exclude
+std::unique_ptr<DocSet> compile(const SegmentedIndex &index, const QueryNode &node, const Bm25 &bm25,
+                                const std::vector<std::string> &words, bool scoring)
+{
+    switch (node.kind)
+    {
+    case QueryNode::TERM:
+    {
+        int wordIndex = -1;
+        if (scoring)
+            wordIndex = (int)(std::find(words.begin(), words.end(), node.word) - words.begin());
+        return std::make_unique<TermSet>(index, node.word, bm25, wordIndex);
+    }
+    case QueryNode::PHRASE:
+    case QueryNode::NEAR:
+    {
+        // The parser gives these TERM and PHRASE operands only
+        std::vector<std::unique_ptr<DocSet>> parts;
+        std::vector<uint32_t> lengths, maxLengths;
+        for (const QueryNode &child : node.children)
+        {
+            parts.push_back(compile(index, child, bm25, words, scoring));
+            lengths.push_back(child.kind == QueryNode::PHRASE ? (uint32_t)child.children.size() : 1);
+            maxLengths.push_back(lengths.back() + (child.kind == QueryNode::PHRASE ? child.slop : 0));
+        }
+        return std::make_unique<PositionalSet>(std::move(parts), std::move(lengths), std::move(maxLengths),
+                                               node.kind == QueryNode::PHRASE, node.slop);
+    }
+    case QueryNode::AND:
+    case QueryNode::NOT:
+    {
+        // NOT on its own excludes from all docs
+        std::vector<std::unique_ptr<DocSet>> required, excluded;
+        if (node.kind == QueryNode::NOT)
+            excluded.push_back(compile(index, node.children[0], bm25, words, false));
+        else
+            for (const QueryNode &child : node.children)
+            {
+                if (child.kind == QueryNode::NOT)
+                    excluded.push_back(compile(index, child.children[0], bm25, words, false));
+                else
+                    required.push_back(compile(index, child, bm25, words, scoring));
+            }
+        if (required.empty())
+            required.push_back(std::make_unique<AllDocs>(index.docCount()));
+        return std::make_unique<AndSet>(std::move(required), std::move(excluded));
+    }
+    case QueryNode::OR:
+    default:
+    {
+        std::vector<std::unique_ptr<DocSet>> sets;
+        for (const QueryNode &child : node.children)
+            sets.push_back(compile(index, child, bm25, words, scoring));
+        return std::make_unique<OrSet>(std::move(sets));
+    }
+    }
+}
+} // namespace
+
+double Bm25::idf(uint32_t docFreq) const
+{
+    if (docFreq == 0 || docCount == 0)
+        return 0.0;
+    // Standard IDF formula with smoothing
+    return std::log(((double)docCount - docFreq + 0.5) / (docFreq + 0.5) + 1.0);
+}
+
+double Bm25::termScore(const uint32_t *fieldFreqs, const uint32_t *fieldLengths, double idf) const
+{
+    // The same few multiplies for every field, present or not: no
+    // branches, and the loop unrolls
+    double tf = 0.0;
+    for (int f = 0; f < SCORED_FIELDS; ++f)
+    {
+        double lengthNorm = 1 - b + b * fieldLengths[f] / avgFieldLength[f];
+        tf += fieldWeight[f] * fieldFreqs[f] / lengthNorm;
+    }
+    return idf * (tf * (k1 + 1) / (tf + k1));
+}
+
+void topKExhaustive(const SegmentedIndex &index, const std::vector<std::string_view> &terms,
+                    const Bm25 &bm25, size_t k, std::vector<ScoredDoc> &out)
+{
+    out.clear();
+    if (k == 0)
+        return;
+
+    // Accumulators by doc number, kept across queries and all zero
+    // between them: only the touched docs are reset, so a query costs its
+    // postings, not the size of the collection
+    thread_local std::vector<double> scores;       // BM25F score
+    thread_local std::vector<uint8_t> termMatches; // query terms matched
+    thread_local std::vector<uint32_t> touched;    // doc numbers with a score
+    if (scores.size() < index.docCount())
+    {
+        scores.resize(index.docCount(), 0.0);
+        termMatches.resize(index.docCount(), 0);
+    }
+    touched.clear();
+
+    // Each term's postings straight through, in every segment, a block
+    // of docs and field freqs at a time
+    for (std::string_view term : terms)
+    {
+        for (TermCursor c(index, term, bm25); c.doc() != END_DOC; c.next())
+        {
+            uint32_t doc = c.doc();
+            if (termMatches[doc]++ == 0)
+                touched.push_back(doc);
+            scores[doc] += c.score(bm25);
+        }
+    }
+
+    for (uint32_t doc : touched)
+    {
+        keepBest(out, k, {coordinated(scores[doc], termMatches[doc], (int)terms.size()), doc});
+        scores[doc] = 0.0;
+        termMatches[doc] = 0;
+    }
+    std::sort_heap(out.begin(), out.end(), ranksBefore);
+}
+
+void topKBlockMaxWand(const SegmentedIndex &index, const std::vector<std::string_view> &terms,
+                      const Bm25 &bm25, size_t k, std::vector<ScoredDoc> &out)
+{
+    out.clear();
+    if (k == 0)
+        return;
+
+    std::vector<TermCursor> cursors; // in query order, for summing scores
+    cursors.reserve(terms.size());
+    for (std::string_view term : terms)
+        cursors.emplace_back(index, term, bm25);
+    std::vector<TermCursor *> order; // by current doc
+    for (TermCursor &c : cursors)
+        if (c.doc() != END_DOC)
+            order.push_back(&c);
+
+    const int termCount = (int)terms.size();
+    auto bound = [&](double sum, size_t matched)
+    { return coordinated(sum, (int)matched, termCount) * BOUND_SLACK; };
+
+    // out holds the best k so far (keepBest); front() is the one to beat
+    double threshold = -1.0; // anything is kept until there are k
+    while (true)
+    {
+        for (size_t i = 1; i < order.size(); ++i)
+            for (size_t j = i; j > 0 && order[j]->doc() < order[j - 1]->doc(); --j)
+                std::swap(order[j], order[j - 1]);
+
+        // Pivot: the first cursor at which the terms so far could beat
+        // the threshold; no doc before it can
+        double sum = 0.0;
+        size_t p = order.size();
+        for (size_t i = 0; i < order.size() && order[i]->doc() != END_DOC; ++i)
+        {
+            sum += order[i]->maxScore;
+            if (bound(sum, i + 1) > threshold)
+            {
+                p = i;
+                break;
+            }
+        }
+        if (p == order.size())
+            break;
+        uint32_t pivot = order[p]->doc();
+        while (p + 1 < order.size() && order[p + 1]->doc() == pivot)
+            ++p;
+
+        // Tighter bound from the blocks that would hold the pivot
+        double blockSum = 0.0;
+        for (size_t i = 0; i <= p; ++i)
+            blockSum += order[i]->blockMax(pivot);
+
+        if (bound(blockSum, p + 1) <= threshold)
+        {
+            // Nothing before the end of these blocks, or before the next
+            // term's doc, can make the top k
+            uint32_t target = p + 1 < order.size() ? order[p + 1]->doc() : END_DOC;
+            TermCursor *mover = order[0];
+            for (size_t i = 0; i <= p; ++i)
+            {
+                if (order[i]->blockEnd() != END_DOC) // else the list ends before the pivot
+                    target = std::min(target, order[i]->blockEnd() + 1);
+                if (order[i]->maxScore > mover->maxScore)
+                    mover = order[i];
+            }
+            mover->seek(target);
+        }
+        else if (order[0]->doc() != pivot)
+        {
+            for (size_t i = 0; i < p && order[i]->doc() < pivot; ++i)
+                order[i]->seek(pivot);
+        }
+        else
+        {
+            double score = 0.0;
+            int matched = 0;
+            for (TermCursor &c : cursors)
+            {
+                if (c.doc() != pivot)
+                    continue;
+                score += c.score(bm25);
+                matched++;
+            }
+            keepBest(out, k, {coordinated(score, matched, termCount), pivot});
+            if (out.size() == k)
+                threshold = out.front().score;
+
+            for (size_t i = 0; i <= p; ++i)
+                order[i]->next();
+        }
+    }
+    std::sort_heap(out.begin(), out.end(), ranksBefore);
+}
+
+void topKBoolean(const SegmentedIndex &index, const QueryNode &query, const Bm25 &bm25, size_t k,
+                 std::vector<ScoredDoc> &out)
+{
+    out.clear();
+    if (k == 0)
+        return;
+
+    std::vector<std::string> words;
+    positiveWords(query, words);
+    Hits hits;
+    hits.matched.assign(words.size(), false);
+    hits.scores.assign(words.size(), 0.0);
+    std::unique_ptr<DocSet> root = compile(index, query, bm25, words, true);
+
+    for (uint32_t doc = root->doc(); doc != END_DOC; root->next(), doc = root->doc())
+    {
+        std::fill(hits.matched.begin(), hits.matched.end(), false);
+        root->collect(doc, hits);
+        double score = 0.0;
+        int matched = 0;
+        for (size_t w = 0; w < words.size(); ++w)
+        {
+            if (!hits.matched[w])
+                continue;
+            score += hits.scores[w];
+            matched++;
+        }
+        keepBest(out, k, {coordinated(score, matched, (int)words.size()), doc});
+    }
+    std::sort_heap(out.begin(), out.end(), ranksBefore);
+}
+
+void rerankByProximity(const SegmentedIndex &index, const std::vector<std::string_view> &terms,
+                       const Bm25 &bm25, size_t depth, std::vector<ScoredDoc> &ranked)
+{
+    size_t n = std::min(depth, ranked.size());
+    if (terms.size() < 2 || n == 0)
+        return;
+
+    // Cursors only move forward, so the candidates are visited by doc
+    std::vector<size_t> byDoc(n);
+    for (size_t i = 0; i < n; ++i)
+        byDoc[i] = i;
+    std::sort(byDoc.begin(), byDoc.end(), [&](size_t a, size_t b) { return ranked[a].doc < ranked[b].doc; });
+
+    std::vector<TermCursor> cursors;
+    cursors.reserve(terms.size());
+    for (std::string_view term : terms)
+        cursors.emplace_back(index, term, bm25);
+
+    struct Occurrence
+    {
+        uint32_t position;
+        uint32_t term;
+    };
+    std::vector<Occurrence> occurrences;
+    std::vector<uint32_t> positions;
+    std::vector<double> acc(terms.size());
+    for (size_t i : byDoc)
+    {
+        uint32_t doc = ranked[i].doc;
+        uint32_t docLength = 0;
+        occurrences.clear();
+        for (uint32_t t = 0; t < cursors.size(); ++t)
+        {
+            TermCursor &c = cursors[t];
+            c.seek(doc);
+            if (c.doc() != doc || !c.positions(positions))
+                continue;
+            docLength = c.docLength();
+            for (uint32_t p : positions)
+                occurrences.push_back({p, t});
+        }
+        std::sort(occurrences.begin(), occurrences.end(),
+                  [](const Occurrence &a, const Occurrence &b) { return a.position < b.position; });
+
+        std::fill(acc.begin(), acc.end(), 0.0);
+        bool near = false;
+        for (size_t a = 0; a < occurrences.size(); ++a)
+            for (size_t b = a + 1;
+                 b < occurrences.size() && occurrences[b].position - occurrences[a].position <= PROXIMITY_WINDOW; ++b)
+            {
+                uint32_t ta = occurrences[a].term, tb = occurrences[b].term;
+                uint32_t distance = occurrences[b].position - occurrences[a].position;
+                if (ta == tb || distance == 0)
+                    continue;
+                double tpi = 1.0 / ((double)distance * distance);
+                acc[ta] += tpi * cursors[tb].idf;
+                acc[tb] += tpi * cursors[ta].idf;
+                near = true;
+            }
+        if (!near)
+            continue;
+
+        double lengthNorm = bm25.k1 * (1 - bm25.b + bm25.b * docLength / bm25.avgDocLength);
+        double proximity = 0.0;
+        for (size_t t = 0; t < terms.size(); ++t)
+            proximity += std::min(1.0, cursors[t].idf) * acc[t] * (bm25.k1 + 1) / (acc[t] + lengthNorm);
+        ranked[i].score += proximity;
+    }
+    std::sort(ranked.begin(), ranked.begin() + n, ranksBefore);
+}
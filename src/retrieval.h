@@ -0,0 +1,94 @@
+#ifndef RETRIEVAL_H
+#define RETRIEVAL_H
+
+#include "segments.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Top-k BM25F retrieval over a SegmentedIndex. A doc's score is the sum
+// of BM25F over the query terms it contains, times the coordination
+// factor 0.5 + 0.5 * matched / terms, so docs with more of the query
+// rank higher. Terms must be distinct, at most MAX_QUERY_TERMS of them,
+// and are summed in the order given, so both strategies below produce
+// the same scores to the bit.
+
+const size_t MAX_QUERY_TERMS = 255;
+
+struct QueryNode;
+
+// BM25F (Robertson, Zaragoza and Taylor): a term's frequency in each
+// ScoredField is normalized by that field's length against its average,
+// weighted, and the sum is saturated once, as BM25 saturates a plain
+// term frequency. Weights must not be negative, nor averages 0.
+struct Bm25
+{
+    double k1 = 1.5; // term frequency saturation
+    double b = 0.75; // document length normalization
+    uint32_t docCount = 0;
+    double avgDocLength = 1.0; // for rerankByProximity
+    double fieldWeight[SCORED_FIELDS] = {3.0, 1.5, 1.0};
+    double avgFieldLength[SCORED_FIELDS] = {1.0, 1.0, 1.0};
+
+    double idf(uint32_t docFreq) const;
+    // fieldFreqs and fieldLengths hold SCORED_FIELDS values each. Higher
+    // freqs and shorter fields never score less, so maxima and minima
+    // over a block bound its scores.
+    double termScore(const uint32_t *fieldFreqs, const uint32_t *fieldLengths, double idf) const;
+};
+
+struct ScoredDoc
+{
+    double score;
+    uint32_t doc; // global doc number
+};
+
+// Higher score first, then lower doc number, so equal scores come out
+// in the same order whichever strategy found them.
+inline bool ranksBefore(const ScoredDoc &a, const ScoredDoc &b)
+{
+    return a.score != b.score ? a.score > b.score : a.doc < b.doc;
+}
+
+// Both strategies fill out with the best k, best first. Candidates go
+// through a heap bounded at k, so the matches are never all sorted.
+
+// Term at a time: scores every posting of every term into dense
+// per-thread accumulators. The reference for topKBlockMaxWand.
+void topKExhaustive(const SegmentedIndex &index, const std::vector<std::string_view> &terms,
+                    const Bm25 &bm25, size_t k, std::vector<ScoredDoc> &out);
+
+// Document at a time with Block-Max WAND. The cursors' best possible
+// scores (per term, and per PostingBlock from its FieldBlock's maxFreq
+// and minLength) are compared with the k-th best score so far, and docs
+// that cannot beat it are skipped, whole blocks at a time, without
+// decoding their postings. Returns the same docs and scores as
+// topKExhaustive.
+void topKBlockMaxWand(const SegmentedIndex &index, const std::vector<std::string_view> &terms,
+                      const Bm25 &bm25, size_t k, std::vector<ScoredDoc> &out);
+
+// Boolean retrieval (query_parser.h): the docs that satisfy the query,
+// ranked by BM25F of the words outside NOT, each counted only if a clause
+// it is in matched the doc. AND leapfrogs its operands from the rarest
+// with galloping seeks, OR merges them with a heap, and NOT skips the
+// docs its operand has. A phrase or NEAR is an AND whose docs must also
+// have its words' positions in place; positions are only decoded for
+// the docs the AND finds. A query that is an OR of words scores exactly
+// as the same words do in the strategies above.
+void topKBoolean(const SegmentedIndex &index, const QueryNode &query, const Bm25 &bm25, size_t k,
+                 std::vector<ScoredDoc> &out);
+
+// Second stage for any of the above: adds a term proximity score
+// (BM25TP, Rasolofo and Savoy) to the first depth docs of ranked, best
+// first, and re-sorts them. Every pair of occurrences of two different
+// terms at most PROXIMITY_WINDOW words apart adds 1 / distance^2 to
+// each term's accumulator, weighted by the other term's idf, and the
+// accumulators are saturated like term frequencies in BM25. Only the
+// positions of those docs are read. Docs past depth keep their order;
+// they score no more than the docs before them did, so still rank after
+// them.
+const uint32_t PROXIMITY_WINDOW = 5;
+void rerankByProximity(const SegmentedIndex &index, const std::vector<std::string_view> &terms,
+                       const Bm25 &bm25, size_t depth, std::vector<ScoredDoc> &ranked);
+
+#endif
@@ -1,21 +1,89 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
-#include <unordered_map>
 #include <algorithm>
+#include <iterator>
 
-#include "tokenizer.h"
+#include "intersect.h"
+#include "query_parser.h"
 #include "lexicon.h"
+#include "postings_format.h"
+#include "doc_table.h"
 
 using namespace std;
 
 struct Result
 {
-    string docID;
+    uint32_t doc; // doc number
     int score;
 };
 
+// Sorted doc numbers that satisfy node
+vector<uint32_t> matchDocs(const QueryNode &node, const Lexicon &lex, const PostingsReader &postings, uint32_t docCount)
+{
+    vector<uint32_t> docs;
+    if (node.kind == QueryNode::TERM)
+    {
+        PostingList list;
+        int qid = lex.getExistingWordID(node.word);
+        if (qid >= 0 && postings.read(qid, list))
+            for (uint32_t d : list.docs)
+                if (d < docCount)
+                    docs.push_back(d);
+        return docs;
+    }
+
+    vector<uint32_t> merged;
+    if (node.kind == QueryNode::OR)
+    {
+        for (const QueryNode &child : node.children)
+        {
+            vector<uint32_t> childDocs = matchDocs(child, lex, postings, docCount);
+            merged.clear();
+            set_union(docs.begin(), docs.end(), childDocs.begin(), childDocs.end(), back_inserter(merged));
+            docs.swap(merged);
+        }
+        return docs;
+    }
+
+    // AND, PHRASE, NEAR and NOT: intersect the positive children from
+    // the shortest list up, so every step is at most that long, then
+    // remove the excluded ones. Only a node with nothing positive
+    // starts from every doc. postings.bin has no positions, so phrases
+    // and NEAR are ANDs here.
+    vector<vector<uint32_t>> included, excluded;
+    for (const QueryNode &child : node.children)
+    {
+        bool exclude = node.kind == QueryNode::NOT || child.kind == QueryNode::NOT;
+        const QueryNode &operand = child.kind == QueryNode::NOT ? child.children[0] : child;
+        (exclude ? excluded : included).push_back(matchDocs(operand, lex, postings, docCount));
+    }
+    sort(included.begin(), included.end(), [](const vector<uint32_t> &a, const vector<uint32_t> &b)
+         { return a.size() < b.size(); });
+
+    if (included.empty())
+    {
+        for (uint32_t d = 0; d < docCount; ++d)
+            docs.push_back(d);
+    }
+    else
+        docs.swap(included[0]);
+    for (size_t i = 1; i < included.size() && !docs.empty(); ++i)
+    {
+        merged.resize(docs.size());
+        merged.resize(intersectSorted(docs.data(), docs.size(), included[i].data(), included[i].size(), merged.data()));
+        docs.swap(merged);
+    }
+    for (const vector<uint32_t> &childDocs : excluded)
+    {
+        if (docs.empty())
+            break;
+        merged.clear();
+        set_difference(docs.begin(), docs.end(), childDocs.begin(), childDocs.end(), back_inserter(merged));
+        docs.swap(merged);
+    }
+    return docs;
+}
+
 int main()
 {
     // ---------------- LOAD LEXICON ----------------
@@ -23,34 +91,19 @@ int main()
     lex.load("data/lexicon.csv");
 
     // ---------------- LOAD POSTINGS ----------------
-    ifstream post("data/postings.csv");
-    if (!post.is_open())
+    PostingsReader postings;
+    if (!postings.load("data/postings.bin"))
     {
-        cout << "ERROR: data/postings.csv not found\n";
+        cout << "ERROR: data/postings.bin not found\n";
         return 1;
     }
 
-    // ---------------- LOAD DOCID → URL ----------------
-    unordered_map<string, string> docURL;
+    // ---------------- LOAD DOC TABLE (DOC NUMBER → CORD_ID, URL) ----------------
+    vector<DocInfo> docTable;
+    if (!loadDocTable("data/doc_table.csv", docTable))
     {
-        ifstream urlFile("data/doc_urls.csv");
-        if (!urlFile.is_open())
-        {
-            cout << "ERROR: data/doc_urls.csv not found\n";
-            return 1;
-        }
-
-        string line;
-        getline(urlFile, line); // skip header
-
-        while (getline(urlFile, line))
-        {
-            string id, url;
-            stringstream ss(line);
-            getline(ss, id, ',');
-            getline(ss, url);
-            docURL[id] = url;
-        }
+        cout << "ERROR: data/doc_table.csv not found\n";
+        return 1;
     }
 
     // ---------------- INPUT QUERY ----------------
@@ -64,69 +117,44 @@ int main()
         return 0;
     }
 
-    // ---------------- LOGIC DETECTION ----------------
-    bool isAND = (query.find("AND") != string::npos);
-    bool isOR = (query.find("OR") != string::npos);
+    // ---------------- PARSE QUERY ----------------
+    // AND, OR, NOT, parentheses and quotes; plain words are ORed
+    QueryNode tree;
+    parseQuery(query, tree);
 
-    vector<string> terms = tokenize(query);
-    if (terms.empty())
+    vector<string> terms;
+    positiveWords(tree, terms);
+    if (tree.kind == QueryNode::OR && tree.children.empty())
     {
         cout << "No valid terms\n";
         return 0;
     }
 
-    unordered_map<string, int> docScores;
-    unordered_map<string, int> docHitCount;
-
-    // ---------------- PROCESS POSTINGS ----------------
-    string line;
-    getline(post, line); // skip header
+    // ---------------- MATCH DOCUMENTS ----------------
+    vector<uint32_t> matched = matchDocs(tree, lex, postings, (uint32_t)docTable.size());
 
-    while (getline(post, line))
+    // ---------------- SCORE MATCHES ----------------
+    vector<int> docScores(docTable.size(), 0);
+    PostingList list;
+    for (auto &t : terms)
     {
-        stringstream ss(line);
-
-        int wid, totalFreq;
-        string docIDs, freqs, prios;
-
-        ss >> wid;
-        ss.ignore(); // comma
-        getline(ss, docIDs, ',');
-        getline(ss, freqs, ',');
-        getline(ss, prios, ',');
-        ss >> totalFreq;
+        int qid = lex.getExistingWordID(t);
+        if (qid < 0 || !postings.read(qid, list))
+            continue;
 
-        for (auto &t : terms)
+        for (size_t i = 0; i < list.docs.size(); ++i)
         {
-            if (!lex.contains(t))
-                continue;
-
-            int qid = lex.getWordID(t);
-            if (qid != wid)
+            uint32_t d = list.docs[i];
+            if (d >= docTable.size())
                 continue;
-
-            stringstream dss(docIDs);
-            stringstream fss(freqs);
-
-            string d, f;
-            while (getline(dss, d, ';') && getline(fss, f, ';'))
-            {
-                int freq = stoi(f);
-                docScores[d] += freq;
-                docHitCount[d]++;
-            }
+            docScores[d] += list.freqs[i];
         }
     }
 
-    // ---------------- FILTER AND RANK ----------------
+    // ---------------- RANK ----------------
     vector<Result> results;
-    for (auto &p : docScores)
-    {
-        if (isAND && docHitCount[p.first] < (int)terms.size())
-            continue;
-
-        results.push_back({p.first, p.second});
-    }
+    for (uint32_t d : matched)
+        results.push_back({d, docScores[d]});
 
     sort(results.begin(), results.end(),
          [](const Result &a, const Result &b)
@@ -144,11 +172,12 @@ int main()
     cout << "\nSearch Results (Ranked):\n";
     for (auto &r : results)
     {
-        cout << "DocID: " << r.docID
+        const DocInfo &info = docTable[r.doc];
+        cout << "DocID: " << info.cordID
              << " | Score: " << r.score;
 
-        if (docURL.count(r.docID))
-            cout << " | URL: " << docURL[r.docID];
+        if (!info.url.empty())
+            cout << " | URL: " << info.url;
 
         cout << "\n";
     }
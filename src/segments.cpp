@@ -0,0 +1,469 @@
+#include "segments.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+const char *MANIFEST = "segments.txt";
+const char *LOCK = "segments.lock";
+
+// Held while reading-modifying-writing the manifest.
+class ManifestLock
+{
+private:
+    fs::path path;
+    bool held = false;
+
+public:
+    explicit ManifestLock(const std::string &dir) : path(fs::path(dir) / LOCK)
+    {
+        for (int attempt = 0; attempt < 300 && !held; ++attempt)
+        {
+            std::error_code ec;
+            held = fs::create_directory(path, ec);
+            if (!held)
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        if (!held)
+            std::cerr << "Cannot lock " << path.string() << " (remove it if no indexer is running)\n";
+    }
+    ~ManifestLock()
+    {
+        if (held)
+        {
+            std::error_code ec;
+            fs::remove(path, ec);
+        }
+    }
+    bool locked() const { return held; }
+};
+
+bool saveManifest(const std::string &dir, const SegmentManifest &m)
+{
+    fs::path tmp = fs::path(dir) / (std::string(MANIFEST) + ".tmp");
+    {
+        std::ofstream out(tmp);
+        if (!out.is_open())
+            return false;
+        out << "generation " << m.generation << "\n";
+        for (auto &s : m.segments)
+            out << s.name << " " << s.docCount << "\n";
+        if (!out.good())
+            return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, fs::path(dir) / MANIFEST, ec);
+    return !ec;
+}
+
+std::string segmentName(uint64_t generation)
+{
+    return "seg_" + std::to_string(generation) + ".img";
+}
+
+int tierOf(uint32_t docs, const TieredMergePolicy &policy)
+{
+    if (docs <= policy.floorDocs)
+        return 0;
+    return 1 + (int)(std::log((double)docs / policy.floorDocs) / std::log((double)policy.mergeFactor));
+}
+} // namespace
+
+// ============================================
+// MANIFEST
+// ============================================
+
+bool loadManifest(const std::string &dir, SegmentManifest &m)
+{
+    std::ifstream in(fs::path(dir) / MANIFEST);
+    if (!in.is_open())
+        return false;
+
+    m = SegmentManifest();
+    std::string line, word;
+    while (getline(in, line))
+    {
+        std::stringstream ss(line);
+        if (!(ss >> word))
+            continue;
+        if (word == "generation")
+            ss >> m.generation;
+        else
+        {
+            SegmentInfo s;
+            s.name = word;
+            ss >> s.docCount;
+            m.segments.push_back(s);
+        }
+    }
+    return true;
+}
+
+std::string newSegmentPath(const std::string &dir)
+{
+    fs::create_directories(dir);
+    auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+    return (fs::path(dir) / ("new_" + std::to_string(ticks) + ".tmp")).string();
+}
+
+bool commitSegment(const std::string &dir, const std::string &tmpPath, uint32_t docCount)
+{
+    ManifestLock lock(dir);
+    if (!lock.locked())
+        return false;
+
+    SegmentManifest m;
+    loadManifest(dir, m);
+    ++m.generation;
+
+    SegmentInfo s{segmentName(m.generation), docCount};
+    std::error_code ec;
+    fs::rename(tmpPath, fs::path(dir) / s.name, ec);
+    if (ec)
+        return false;
+    m.segments.push_back(s);
+    return saveManifest(dir, m);
+}
+
+void removeDeadSegments(const std::string &dir)
+{
+    ManifestLock lock(dir);
+    SegmentManifest m;
+    if (!lock.locked() || !loadManifest(dir, m))
+        return;
+
+    std::error_code ec;
+    for (auto &entry : fs::directory_iterator(dir, ec))
+    {
+        std::string name = entry.path().filename().string();
+        if (entry.path().extension() != ".img")
+            continue;
+        bool live = std::any_of(m.segments.begin(), m.segments.end(), [&](const SegmentInfo &s)
+                                { return s.name == name; });
+        if (!live)
+            fs::remove(entry.path(), ec);
+    }
+}
+
+// ============================================
+// SEGMENTED INDEX
+// ============================================
+
+bool SegmentedIndex::add(const std::string &path)
+{
+    auto image = std::make_unique<IndexImage>();
+    if (!image->open(path))
+    {
+        std::cerr << "Warning: Could not open segment " << path << "\n";
+        return false;
+    }
+
+    // Running average, weighted by doc count
+    uint32_t docs = (uint32_t)image->docCount();
+    if (totalDocs + docs > 0)
+    {
+        avgLength = (avgLength * totalDocs + image->avgDocLength() * docs) / (totalDocs + docs);
+        for (int f = 0; f < SCORED_FIELDS; ++f)
+            avgFieldLengths[f] =
+                (avgFieldLengths[f] * totalDocs + image->avgFieldLength(f) * docs) / (totalDocs + docs);
+    }
+    bases.push_back(totalDocs);
+    totalDocs += docs;
+    images.push_back(std::move(image));
+    return true;
+}
+
+bool SegmentedIndex::open(const std::string &dir)
+{
+    SegmentManifest m;
+    if (!loadManifest(dir, m))
+        return false;
+
+    gen = m.generation;
+    bool ok = true;
+    for (auto &s : m.segments)
+        ok = add((fs::path(dir) / s.name).string()) && ok;
+    return ok;
+}
+
+bool SegmentedIndex::openImage(const std::string &path)
+{
+    return add(path);
+}
+
+std::string_view SegmentedIndex::docField(uint32_t doc, DocField field) const
+{
+    size_t s = std::upper_bound(bases.begin(), bases.end(), doc) - bases.begin() - 1;
+    return images[s]->docField(doc - bases[s], field);
+}
+
+// ============================================
+// MERGING
+// ============================================
+
+std::vector<size_t> TieredMergePolicy::findMerge(const SegmentManifest &m) const
+{
+    size_t factor = std::max<size_t>(mergeFactor, 2);
+    std::vector<int> tiers;
+    int topTier = 0;
+    for (auto &s : m.segments)
+    {
+        tiers.push_back(tierOf(s.docCount, *this));
+        topTier = std::max(topTier, tiers.back());
+    }
+
+    // Only neighbours in manifest order are merged, so doc numbers keep
+    // their order. Smallest tier first: those merges are cheap and
+    // remove the most segments per doc rewritten. A run for tier t may
+    // take in smaller segments between two or more of its own, so one
+    // stuck between bigger neighbours is still merged eventually.
+    for (int t = 0; t <= topTier; ++t)
+    {
+        size_t run = 0;
+        for (size_t i = 0; i < tiers.size(); ++i)
+        {
+            run = tiers[i] <= t ? run + 1 : 0;
+            if (run < factor)
+                continue;
+            size_t first = i + 1 - factor;
+            if (std::count(tiers.begin() + first, tiers.begin() + i + 1, t) >= 2)
+            {
+                std::vector<size_t> picked(factor);
+                std::iota(picked.begin(), picked.end(), first);
+                return picked;
+            }
+        }
+    }
+    return {};
+}
+
+bool mergeImages(const std::vector<const IndexImage *> &inputs, const std::string &outPath)
+{
+    if (inputs.empty())
+        return false;
+
+    std::unordered_map<std::string, int> words;
+    std::vector<int> wordIDs;
+    std::vector<uint32_t> bases;
+    std::vector<ImageDoc> docs;
+    std::vector<std::string> docIDs;
+    for (const IndexImage *in : inputs)
+    {
+        for (size_t i = 0; i < in->wordCount(); ++i)
+            words.emplace(std::string(in->word(i)), 0);
+        for (size_t i = 0; i < in->postings().termCount(); ++i)
+            wordIDs.push_back(in->postings().entry(i).wordID);
+
+        bases.push_back((uint32_t)docs.size());
+        for (uint32_t d = 0; d < in->docCount(); ++d)
+        {
+            ImageDoc doc;
+            for (int f = 0; f < DOC_FIELDS; ++f)
+                doc.fields[f] = std::string(in->docField(d, (DocField)f));
+            doc.length = in->docLength(d);
+            std::copy(in->fieldLengths(d), in->fieldLengths(d) + SCORED_FIELDS, doc.fieldLengths);
+            docIDs.push_back(doc.fields[DOC_CORD_ID]);
+            docs.push_back(std::move(doc));
+        }
+    }
+    std::sort(wordIDs.begin(), wordIDs.end());
+    wordIDs.erase(std::unique(wordIDs.begin(), wordIDs.end()), wordIDs.end());
+
+    std::string postingsPath = outPath + ".postings";
+    {
+        PostingsWriter writer(postingsPath, inputs[0]->postings().getCodec());
+        if (!writer.isOpen())
+            return false;
+
+        // Inputs hold disjoint, ordered doc ranges, so appending each
+        // input's list in turn keeps the merged list sorted.
+        PostingList merged, part;
+        for (int wordID : wordIDs)
+        {
+            merged.docs.clear();
+            merged.freqs.clear();
+            merged.fields.clear();
+            for (size_t s = 0; s < inputs.size(); ++s)
+            {
+                if (!inputs[s]->postings().read(wordID, part))
+                    continue;
+                for (uint32_t d : part.docs)
+                    merged.docs.push_back(d + bases[s]);
+                merged.freqs.insert(merged.freqs.end(), part.freqs.begin(), part.freqs.end());
+                merged.fields.insert(merged.fields.end(), part.fields.begin(), part.fields.end());
+            }
+            writer.addTerm(wordID, merged);
+        }
+        writer.finish(docIDs);
+    }
+
+    std::ifstream post(postingsPath, std::ios::binary | std::ios::ate);
+    std::vector<uint8_t> postingsFile((size_t)post.tellg());
+    post.seekg(0);
+    post.read(reinterpret_cast<char *>(postingsFile.data()), postingsFile.size());
+    post.close();
+    fs::remove(postingsPath);
+
+    // The lexicon section maps words to their shared IDs; any input
+    // that has a word has the same ID for it.
+    std::vector<std::pair<std::string, int>> lexicon;
+    lexicon.reserve(words.size());
+    for (auto &w : words)
+    {
+        for (const IndexImage *in : inputs)
+        {
+            int id = in->wordID(w.first);
+            if (id >= 0)
+            {
+                lexicon.emplace_back(w.first, id);
+                break;
+            }
+        }
+    }
+
+    // Positions are asked for in the merged lists' order, so each input's
+    // are read straight through, one word at a time. An input's
+    // positions for a word lie back to back, block after block.
+    struct PositionReader
+    {
+        int wordID = -1;
+        const uint8_t *at = nullptr; // nullptr: the input has none for the word
+    };
+    std::vector<PositionReader> readers(inputs.size());
+    auto positions = [&](int wordID, uint32_t doc, std::vector<uint32_t> &out)
+    {
+        size_t s = std::upper_bound(bases.begin(), bases.end(), doc) - bases.begin() - 1;
+        PositionReader &r = readers[s];
+        if (r.wordID != wordID)
+        {
+            const TermEntry *entry = inputs[s]->postings().find(wordID);
+            r.wordID = wordID;
+            r.at = entry ? inputs[s]->blockPositions(inputs[s]->blocks(*entry)) : nullptr;
+        }
+        if (!r.at)
+            return false;
+        r.at = readPositions(r.at, out);
+        return true;
+    };
+
+    // Field freqs likewise, decoded an input's block at a time
+    struct FieldFreqReader
+    {
+        int wordID = -1;
+        const TermEntry *entry = nullptr;
+        uint32_t next = 0; // the word's next posting in the input
+        uint32_t freqs[SCORED_FIELDS][BITPACK_BLOCK];
+    };
+    std::vector<FieldFreqReader> fieldReaders(inputs.size());
+    auto fieldFreqs = [&](int wordID, uint32_t doc, uint32_t *out)
+    {
+        size_t s = std::upper_bound(bases.begin(), bases.end(), doc) - bases.begin() - 1;
+        FieldFreqReader &r = fieldReaders[s];
+        const IndexImage &in = *inputs[s];
+        if (r.wordID != wordID)
+        {
+            r.wordID = wordID;
+            r.entry = in.postings().find(wordID);
+            r.next = 0;
+        }
+        if (!r.entry || r.next >= r.entry->df)
+            return false;
+        uint32_t i = r.next % BITPACK_BLOCK;
+        if (i == 0)
+        {
+            const PostingBlock *block = in.blocks(*r.entry) + r.next / BITPACK_BLOCK;
+            readFieldFreqs(in.postings().getCodec(), in.blockFieldFreqs(block),
+                           std::min<uint32_t>(BITPACK_BLOCK, r.entry->df - r.next), r.freqs);
+        }
+        ++r.next;
+        for (int f = 0; f < SCORED_FIELDS; ++f)
+            out[f] = r.freqs[f][i];
+        return true;
+    };
+    return writeIndexImage(outPath, lexicon, postingsFile, docs, positions, fieldFreqs);
+}
+
+int mergeSegments(const std::string &dir, const TieredMergePolicy &policy)
+{
+    int merges = 0;
+    SegmentManifest m;
+    while (loadManifest(dir, m))
+    {
+        std::vector<size_t> picked = policy.findMerge(m);
+        if (picked.empty())
+            break;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<SegmentInfo> inputs;
+        std::string tmpPath = newSegmentPath(dir);
+        uint32_t docCount = 0;
+        bool ok;
+        {
+            std::vector<std::unique_ptr<IndexImage>> images;
+            std::vector<const IndexImage *> views;
+            ok = true;
+            for (size_t i : picked)
+            {
+                inputs.push_back(m.segments[i]);
+                images.push_back(std::make_unique<IndexImage>());
+                ok = images.back()->open((fs::path(dir) / m.segments[i].name).string()) && ok;
+                views.push_back(images.back().get());
+                docCount += m.segments[i].docCount;
+            }
+            ok = ok && mergeImages(views, tmpPath);
+        }
+
+        // Swap the inputs for the merged segment where they stand,
+        // unless another process changed them meanwhile; they must still
+        // be next to each other and in order.
+        ManifestLock lock(dir);
+        SegmentManifest current;
+        if (ok && lock.locked() && loadManifest(dir, current))
+        {
+            auto first = std::find_if(current.segments.begin(), current.segments.end(), [&](const SegmentInfo &s)
+                                      { return s.name == inputs[0].name; });
+            bool inPlace = (size_t)(current.segments.end() - first) >= inputs.size() &&
+                           std::equal(inputs.begin(), inputs.end(), first, [](const SegmentInfo &a, const SegmentInfo &b)
+                                      { return a.name == b.name; });
+            ++current.generation;
+            SegmentInfo merged{segmentName(current.generation), docCount};
+            std::error_code ec;
+            if (inPlace)
+                fs::rename(tmpPath, fs::path(dir) / merged.name, ec);
+            if (inPlace && !ec)
+            {
+                *first = merged;
+                current.segments.erase(first + 1, first + inputs.size());
+                ok = saveManifest(dir, current);
+            }
+            else
+                ok = false;
+        }
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            std::error_code ec;
+            fs::remove(tmpPath, ec);
+            std::cerr << "Segment merge abandoned\n";
+            break;
+        }
+
+        ++merges;
+        std::cout << "Merged " << inputs.size() << " segments (" << docCount << " docs) in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                  << "s" << std::endl;
+    }
+    return merges;
+}
@@ -0,0 +1,104 @@
+#ifndef SEGMENTS_H
+#define SEGMENTS_H
+
+#include "index_image.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Segmented index. Each indexing run writes its documents as a new,
+// immutable segment (an index image, see index_image.h) and commits it
+// to the manifest segments.txt in the segment directory:
+//
+//   generation 7
+//   seg_3.img 1200        one line per live segment: file, doc count
+//   seg_7.img 85
+//
+// Segment files are never modified. A merge writes a new segment and
+// swaps it for its inputs in a single manifest commit. Commits hold
+// segments.lock (a directory, so creating it is atomic) so an indexer
+// and a merging server can both update the manifest. Word IDs come from
+// the shared data/lexicon.csv and agree across segments.
+
+struct SegmentInfo
+{
+    std::string name; // file name inside the segment directory
+    uint32_t docCount = 0;
+};
+
+struct SegmentManifest
+{
+    uint64_t generation = 0;
+    std::vector<SegmentInfo> segments;
+};
+
+// Returns false if dir has no manifest yet.
+bool loadManifest(const std::string &dir, SegmentManifest &m);
+
+// A path in dir to write a new segment to. It is not live (and not
+// touched by removeDeadSegments) until commitSegment.
+std::string newSegmentPath(const std::string &dir);
+
+// Moves a finished segment into place and adds it to the manifest.
+bool commitSegment(const std::string &dir, const std::string &tmpPath, uint32_t docCount);
+
+// Deletes segment files that are no longer in the manifest. Files still
+// mapped by another process on Windows fail to delete and are retried
+// on the next call.
+void removeDeadSegments(const std::string &dir);
+
+// All live segments of one manifest generation, opened together.
+// Doc numbers are global: segment i holds docs docBase(i) onwards.
+class SegmentedIndex
+{
+private:
+    std::vector<std::unique_ptr<IndexImage>> images;
+    std::vector<uint32_t> bases;
+    uint32_t totalDocs = 0;
+    double avgLength = 1.0;
+    double avgFieldLengths[SCORED_FIELDS] = {};
+    uint64_t gen = 0;
+
+    bool add(const std::string &path);
+
+public:
+    bool open(const std::string &dir);         // every segment in the manifest
+    bool openImage(const std::string &path);   // a single image, e.g. data/index.img
+
+    uint64_t generation() const { return gen; }
+    size_t segmentCount() const { return images.size(); }
+    const IndexImage &segment(size_t i) const { return *images[i]; }
+    uint32_t docBase(size_t i) const { return bases[i]; }
+
+    uint32_t docCount() const { return totalDocs; }
+    double avgDocLength() const { return avgLength; }
+    double avgFieldLength(int field) const { return avgFieldLengths[field]; }
+    std::string_view docField(uint32_t doc, DocField field) const;
+};
+
+// Groups segments into tiers of roughly equal size (tier t holds
+// segments of up to floorDocs * mergeFactor^t docs) and merges
+// mergeFactor neighbouring segments of a tier once that many are next
+// to each other, so every doc is rewritten about log(N) times in total.
+// Only runs adjacent in the manifest are merged, which keeps global doc
+// numbers in the same order.
+struct TieredMergePolicy
+{
+    size_t mergeFactor = 4;
+    uint32_t floorDocs = 1000; // segments up to this size share tier 0
+
+    // Consecutive indices into m.segments to merge next, or empty if
+    // none is due.
+    std::vector<size_t> findMerge(const SegmentManifest &m) const;
+};
+
+// Writes one image holding every doc of inputs, in order.
+bool mergeImages(const std::vector<const IndexImage *> &inputs, const std::string &outPath);
+
+// Runs the policy on dir until no merge is due; returns the number of
+// merges committed.
+int mergeSegments(const std::string &dir, const TieredMergePolicy &policy = TieredMergePolicy());
+
+#endif
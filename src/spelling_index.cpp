@@ -0,0 +1,187 @@
+#include "spelling_index.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+struct SpellingHeader
+{
+    uint32_t bucketCount;
+    uint32_t maxDistance;
+    uint32_t prefixLength;
+    uint32_t reserved;
+    uint64_t postingCount;
+};
+
+template <typename T>
+void appendPod(std::vector<uint8_t> &out, const T &v)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+// Stored indexes depend on this function; changing it needs a new
+// image version.
+uint64_t hashDelete(std::string_view s)
+{
+    uint64_t h = 0xCBF29CE484222325ull; // FNV-1a
+    for (char c : s)
+        h = (h ^ (uint8_t)c) * 0x100000001B3ull;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Monotonic in the hash, so postings sorted by hash are sorted by bucket
+uint32_t bucketOf(uint64_t hash, uint32_t buckets)
+{
+    return (uint32_t)(((hash >> 32) * buckets) >> 32);
+}
+
+// s and every distinct string made by deleting up to maxDistance of its
+// characters, shortest last
+void deletes(std::string_view s, uint32_t maxDistance, std::vector<std::string> &out)
+{
+    out.assign(1, std::string(s));
+    size_t levelStart = 0;
+    for (uint32_t d = 0; d < maxDistance; ++d)
+    {
+        size_t levelEnd = out.size();
+        for (size_t i = levelStart; i < levelEnd; ++i)
+        {
+            for (size_t j = 0; j < out[i].size(); ++j)
+            {
+                std::string shorter = out[i];
+                shorter.erase(j, 1);
+                if (std::find(out.begin() + levelEnd, out.end(), shorter) == out.end())
+                    out.push_back(std::move(shorter));
+            }
+        }
+        levelStart = levelEnd;
+    }
+}
+} // namespace
+
+uint32_t editDistance(std::string_view a, std::string_view b, uint32_t limit)
+{
+    size_t lengthGap = a.size() > b.size() ? a.size() - b.size() : b.size() - a.size();
+    if (lengthGap > limit)
+        return limit + 1;
+
+    // Rows i - 2, i - 1 and i of the table over prefixes of a and b, on
+    // the stack for words of ordinary length
+    const size_t width = b.size() + 1;
+    uint32_t stackRows[3 * 64];
+    std::vector<uint32_t> heapRows;
+    uint32_t *older = stackRows;
+    if (3 * width > sizeof(stackRows) / sizeof(stackRows[0]))
+    {
+        heapRows.resize(3 * width);
+        older = heapRows.data();
+    }
+    uint32_t *prev = older + width, *cur = prev + width;
+    for (size_t j = 0; j <= b.size(); ++j)
+        prev[j] = (uint32_t)j;
+    for (size_t i = 1; i <= a.size(); ++i)
+    {
+        cur[0] = (uint32_t)i;
+        uint32_t rowMin = cur[0];
+        for (size_t j = 1; j <= b.size(); ++j)
+        {
+            uint32_t best = prev[j - 1] + (a[i - 1] != b[j - 1]);
+            best = std::min(best, prev[j] + 1);
+            best = std::min(best, cur[j - 1] + 1);
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+                best = std::min(best, older[j - 2] + 1);
+            cur[j] = best;
+            rowMin = std::min(rowMin, best);
+        }
+        if (rowMin > limit)
+            return limit + 1;
+        std::swap(older, prev);
+        std::swap(prev, cur);
+    }
+    return std::min(prev[b.size()], limit + 1);
+}
+
+void SpellingIndex::write(const std::vector<std::string> &words, std::vector<uint8_t> &out)
+{
+    std::vector<std::pair<uint64_t, uint32_t>> keyed; // delete hash, word index
+    std::vector<std::string> variants;
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        deletes(std::string_view(words[i]).substr(0, PREFIX_LENGTH), MAX_DISTANCE, variants);
+        for (const std::string &v : variants)
+            keyed.push_back({hashDelete(v), (uint32_t)i});
+    }
+    std::sort(keyed.begin(), keyed.end());
+    keyed.erase(std::unique(keyed.begin(), keyed.end()), keyed.end());
+
+    // About one distinct delete string per bucket
+    SpellingHeader header{};
+    for (size_t i = 0; i < keyed.size(); ++i)
+        if (i == 0 || keyed[i].first != keyed[i - 1].first)
+            ++header.bucketCount;
+    header.maxDistance = MAX_DISTANCE;
+    header.prefixLength = PREFIX_LENGTH;
+    header.postingCount = keyed.size();
+
+    appendPod(out, header);
+    size_t k = 0;
+    for (uint32_t bucket = 0; bucket <= header.bucketCount; ++bucket)
+    {
+        appendPod(out, (uint32_t)k);
+        while (k < keyed.size() && bucketOf(keyed[k].first, header.bucketCount) == bucket)
+            ++k;
+    }
+    for (auto &entry : keyed)
+        appendPod(out, entry.second);
+}
+
+bool SpellingIndex::attach(const uint8_t *section, size_t size)
+{
+    SpellingHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, section, sizeof(header));
+
+    uint64_t postingsOffset = sizeof(header) + 4ull * (header.bucketCount + 1);
+    if (postingsOffset + 4 * header.postingCount > size)
+        return false;
+
+    bucketOffsets = reinterpret_cast<const uint32_t *>(section + sizeof(header));
+    postings = reinterpret_cast<const uint32_t *>(section + postingsOffset);
+    numBuckets = header.bucketCount;
+    maxEdits = header.maxDistance;
+    prefixLength = header.prefixLength;
+    return bucketOffsets[numBuckets] == header.postingCount;
+}
+
+void SpellingIndex::lookup(std::string_view word, uint32_t maxDistance, const PrefixDictionary &dict,
+                           std::vector<Match> &out) const
+{
+    if (numBuckets == 0)
+        return;
+    maxDistance = std::min(maxDistance, maxEdits);
+
+    std::vector<std::string> variants;
+    deletes(word.substr(0, prefixLength), maxDistance, variants);
+    std::vector<uint32_t> candidates;
+    for (const std::string &v : variants)
+    {
+        uint32_t bucket = bucketOf(hashDelete(v), numBuckets);
+        candidates.insert(candidates.end(), postings + bucketOffsets[bucket], postings + bucketOffsets[bucket + 1]);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::string candidate;
+    for (uint32_t index : candidates)
+    {
+        dict.word(index, candidate);
+        uint32_t distance = editDistance(word, candidate, maxDistance);
+        if (distance <= maxDistance)
+            out.push_back({index, distance});
+    }
+}
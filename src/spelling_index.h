@@ -0,0 +1,61 @@
+#ifndef SPELLING_INDEX_H
+#define SPELLING_INDEX_H
+
+#include "prefix_dictionary.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Symmetric delete index for spelling correction (as in SymSpell),
+// stored as one flat section, host byte order:
+//
+//   header    bucketCount, maxDistance, prefixLength, posting count
+//   buckets   uint32 x (bucketCount + 1), offset of each bucket's postings
+//   postings  uint32 word indexes into the PrefixDictionary the index
+//             was written for
+//
+// Every string made by deleting up to maxDistance characters from the
+// first prefixLength characters of a word is hashed to a bucket that
+// lists the word. Two words within maxDistance edits share such a
+// string, so a lookup only deletes from the misspelled word and reads
+// those buckets; nothing is enumerated over the lexicon. The delete
+// strings themselves are not stored, and hash collisions only add
+// candidates that fail the distance check.
+class SpellingIndex
+{
+private:
+    const uint32_t *bucketOffsets = nullptr;
+    const uint32_t *postings = nullptr;
+    uint32_t numBuckets = 0;
+    uint32_t maxEdits = 0;
+    uint32_t prefixLength = 0;
+
+public:
+    static const uint32_t MAX_DISTANCE = 2;
+    static const uint32_t PREFIX_LENGTH = 7;
+
+    // Appends the section for the words of a PrefixDictionary, in its
+    // order.
+    static void write(const std::vector<std::string> &words, std::vector<uint8_t> &out);
+
+    // The bytes must stay valid while the index is used.
+    bool attach(const uint8_t *section, size_t size);
+
+    struct Match
+    {
+        uint32_t index;    // into the dictionary
+        uint32_t distance; // edits, counting a swap of neighbours as one
+    };
+
+    // Appends the dictionary words within maxDistance edits of word,
+    // word itself included if present.
+    void lookup(std::string_view word, uint32_t maxDistance, const PrefixDictionary &dict,
+                std::vector<Match> &out) const;
+};
+
+// Optimal string alignment distance (Levenshtein plus transposition of
+// adjacent characters); any value above limit comes back as limit + 1.
+uint32_t editDistance(std::string_view a, std::string_view b, uint32_t limit);
+
+#endif
@@ -0,0 +1,228 @@
+#include "spimi.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+double secondsSince(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+} // namespace
+
+SpimiInverter::SpimiInverter(const std::string &runDir, size_t memoryLimit)
+    : runDir(runDir),
+      memoryLimit(memoryLimit),
+      maxBuffered(std::max<size_t>(memoryLimit / sizeof(Posting), 1)),
+      start(std::chrono::steady_clock::now())
+{
+    fs::create_directories(runDir);
+    buffer.reserve(maxBuffered);
+}
+
+uint32_t SpimiInverter::addDocument(const std::string &docID)
+{
+    docIDs.push_back(docID);
+    docIDBytes += sizeof(std::string) + docIDs.back().capacity();
+    return (uint32_t)(docIDs.size() - 1);
+}
+
+void SpimiInverter::add(int wordID, uint32_t doc, int freq, int priority)
+{
+    buffer.push_back({wordID, doc, freq, priority});
+    ++totalPostings;
+    if (buffer.size() >= maxBuffered || buffer.size() * sizeof(Posting) + docIDBytes >= memoryLimit)
+        spill();
+}
+
+void SpimiInverter::writeRun(const std::string &path, const std::vector<Posting> &postings)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(postings.data()), postings.size() * sizeof(Posting));
+}
+
+void SpimiInverter::spill()
+{
+    if (buffer.empty())
+        return;
+
+    // A word has one posting per doc, so (wordID, doc) orders them
+    // fully; std::sort needs no buffer of its own, unlike stable_sort.
+    std::sort(buffer.begin(), buffer.end(), [](const Posting &a, const Posting &b)
+              { return a.wordID != b.wordID ? a.wordID < b.wordID : a.doc < b.doc; });
+
+    std::string path = runDir + "/run_" + std::to_string(nextRunID++) + ".bin";
+    writeRun(path, buffer);
+    runPaths.push_back(path);
+
+    double secs = secondsSince(start);
+    std::cout << "Spilled run " << runPaths.size() << ": " << buffer.size() << " postings, "
+              << totalPostings << " total, " << (long long)(totalPostings / std::max(secs, 1e-9))
+              << " postings/s" << std::endl;
+    buffer.clear();
+}
+
+template <typename Emit>
+void SpimiInverter::mergeRuns(const std::vector<std::string> &paths, Emit emit)
+{
+    // One buffered cursor per run; the heap always holds each cursor's
+    // current posting, ordered by (wordID, doc).
+    struct RunCursor
+    {
+        std::ifstream in;
+        std::vector<Posting> block;
+        size_t pos = 0;
+
+        bool next(Posting &p)
+        {
+            if (pos == block.size())
+            {
+                block.resize(4096);
+                in.read(reinterpret_cast<char *>(block.data()), block.size() * sizeof(Posting));
+                block.resize(in.gcount() / sizeof(Posting));
+                pos = 0;
+                if (block.empty())
+                    return false;
+            }
+            p = block[pos++];
+            return true;
+        }
+    };
+
+    std::vector<std::unique_ptr<RunCursor>> runs;
+    using Head = std::pair<Posting, size_t>;
+    auto later = [](const Head &a, const Head &b)
+    {
+        if (a.first.wordID != b.first.wordID)
+            return a.first.wordID > b.first.wordID;
+        return a.first.doc > b.first.doc;
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heap(later);
+
+    for (auto &path : paths)
+    {
+        auto cursor = std::make_unique<RunCursor>();
+        cursor->in.open(path, std::ios::binary);
+        Posting p;
+        if (cursor->next(p))
+            heap.push({p, runs.size()});
+        runs.push_back(std::move(cursor));
+    }
+
+    while (!heap.empty())
+    {
+        auto [p, run] = heap.top();
+        heap.pop();
+        emit(p);
+
+        Posting nextP;
+        if (runs[run]->next(nextP))
+            heap.push({nextP, run});
+    }
+
+    runs.clear();
+    for (auto &path : paths)
+        fs::remove(path);
+}
+
+void SpimiInverter::finish(const std::string &postingsPath,
+                           const std::string &binaryPath,
+                           PostingsCodec codec)
+{
+    spill();
+
+    // Too many runs to open at once: merge them in groups first.
+    while (runPaths.size() > MAX_FAN_IN)
+    {
+        std::vector<std::string> merged;
+        for (size_t i = 0; i < runPaths.size(); i += MAX_FAN_IN)
+        {
+            std::vector<std::string> group(runPaths.begin() + i,
+                                           runPaths.begin() + std::min(i + MAX_FAN_IN, runPaths.size()));
+            std::string path = runDir + "/run_" + std::to_string(nextRunID++) + ".bin";
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            std::vector<Posting> block;
+            block.reserve(4096);
+            mergeRuns(group, [&](const Posting &p)
+                      {
+                          block.push_back(p);
+                          if (block.size() == 4096)
+                          {
+                              out.write(reinterpret_cast<const char *>(block.data()), block.size() * sizeof(Posting));
+                              block.clear();
+                          }
+                      });
+            out.write(reinterpret_cast<const char *>(block.data()), block.size() * sizeof(Posting));
+            merged.push_back(path);
+        }
+        runPaths = merged;
+    }
+
+    std::ofstream out(postingsPath);
+    out << "wordID,docIDs,freqs,priorities,totalFreq\n";
+
+    std::unique_ptr<PostingsWriter> binary;
+    if (!binaryPath.empty())
+        binary = std::make_unique<PostingsWriter>(binaryPath, codec);
+    PostingList list;
+
+    auto mergeStart = std::chrono::steady_clock::now();
+    size_t runCount = runPaths.size();
+    long long merged = 0;
+    int curWord = -1;
+    long long total = 0;
+    std::string docs, freqs, prios;
+
+    auto flushWord = [&]
+    {
+        if (curWord >= 0)
+            out << curWord << "," << docs << "," << freqs << "," << prios << "," << total << "\n";
+        if (curWord >= 0 && binary)
+            binary->addTerm(curWord, list);
+        list.docs.clear();
+        list.freqs.clear();
+        list.fields.clear();
+        docs.clear();
+        freqs.clear();
+        prios.clear();
+        total = 0;
+    };
+
+    mergeRuns(runPaths, [&](const Posting &p)
+              {
+                  if (p.wordID != curWord)
+                  {
+                      flushWord();
+                      curWord = p.wordID;
+                  }
+                  else
+                  {
+                      docs += ';';
+                      freqs += ';';
+                      prios += ';';
+                  }
+                  docs += docIDs[p.doc];
+                  freqs += std::to_string(p.freq);
+                  prios += std::to_string(p.priority);
+                  total += p.freq;
+                  list.docs.push_back(p.doc);
+                  list.freqs.push_back((uint32_t)p.freq);
+                  list.fields.push_back((uint32_t)p.priority);
+                  ++merged;
+              });
+    flushWord();
+    runPaths.clear();
+    if (binary)
+        binary->finish(docIDs);
+
+    std::cout << "Merged " << runCount << " run(s), " << merged << " postings in "
+              << secondsSince(mergeStart) << "s (" << totalPostings << " postings inverted at "
+              << (long long)(totalPostings / std::max(secondsSince(start), 1e-9)) << " postings/s)"
+              << std::endl;
+}
@@ -0,0 +1,64 @@
+#ifndef SPIMI_H
+#define SPIMI_H
+
+#include "postings_format.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Single-pass in-memory inversion. Postings are collected in a buffer
+// and a full buffer is sorted by (wordID, doc) in place and spilled to
+// disk as a run. The buffer and the doc IDs (one string per doc, kept
+// for finish) share memoryLimit bytes, so the buffer spills sooner as
+// the doc IDs grow. finish() streams a k-way merge of all runs into
+// postings.csv and postings.bin.
+class SpimiInverter
+{
+private:
+    struct Posting
+    {
+        int32_t wordID;
+        uint32_t doc; // position of the document in docIDs
+        int32_t freq;
+        int32_t priority;
+    };
+
+    std::string runDir;
+    size_t memoryLimit;
+    size_t maxBuffered;    // postings that fit in memoryLimit
+    size_t docIDBytes = 0; // held by docIDs
+    std::vector<Posting> buffer;
+    std::vector<std::string> runPaths;
+    std::vector<std::string> docIDs; // doc number -> cord_id
+    int nextRunID = 0;
+
+    static constexpr size_t MAX_FAN_IN = 64; // runs open at once during a merge
+
+    long long totalPostings = 0;
+    std::chrono::steady_clock::time_point start;
+
+    void spill();
+    void writeRun(const std::string &path, const std::vector<Posting> &postings);
+
+    // Streams the postings of several runs in (wordID, doc) order.
+    template <typename Emit>
+    void mergeRuns(const std::vector<std::string> &paths, Emit emit);
+
+public:
+    explicit SpimiInverter(const std::string &runDir = "data/runs",
+                           size_t memoryLimit = 256u << 20);
+
+    // Documents must be added in order; returns the doc number.
+    uint32_t addDocument(const std::string &docID);
+    void add(int wordID, uint32_t doc, int freq, int priority);
+
+    // Writes wordID,docIDs,freqs,priorities,totalFreq sorted by wordID,
+    // plus the binary postings file when binaryPath is set, and removes
+    // the run files.
+    void finish(const std::string &postingsPath,
+                const std::string &binaryPath = "",
+                PostingsCodec codec = PostingsCodec::VByte);
+};
+
+#endif
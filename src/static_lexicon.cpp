@@ -0,0 +1,215 @@
+#include "static_lexicon.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+struct LexiconHeader
+{
+    uint32_t wordCount;
+    uint32_t bucketCount;
+    uint64_t seed;
+    uint64_t poolBytes;
+};
+
+const uint32_t WORDS_PER_BUCKET = 4;
+const uint64_t MAX_SEEDS = 64; // each retry is unlikely to be needed at all
+const uint64_t GOLDEN = 0x9E3779B97F4A7C15ull;
+
+uint64_t mix(uint64_t x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Stored lexicons depend on this function; changing it needs a new
+// image version.
+uint64_t hashWord(std::string_view w, uint64_t seed)
+{
+    uint64_t h = seed ^ (w.size() * GOLDEN);
+    size_t i = 0;
+    for (; i + 8 <= w.size(); i += 8)
+    {
+        uint64_t k;
+        std::memcpy(&k, w.data() + i, 8);
+        h = (h ^ mix(k)) * GOLDEN;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, w.data() + i, w.size() - i);
+    return mix(h ^ tail);
+}
+
+// Maps a 32-bit value onto [0, n) with a multiply instead of a modulo
+uint32_t scaleTo(uint32_t x, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+uint32_t bucketOf(uint64_t hash, uint32_t buckets)
+{
+    return scaleTo((uint32_t)(hash >> 32), buckets);
+}
+
+uint32_t slotOf(uint64_t hash, uint32_t pilot, uint32_t words)
+{
+    return scaleTo((uint32_t)mix(hash ^ (pilot * GOLDEN)), words);
+}
+
+template <typename T>
+void appendPod(std::vector<uint8_t> &out, const T &v)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+// Finds a pilot for every bucket, biggest buckets first while most
+// slots are still free. Returns false if some bucket cannot be placed
+// (e.g. two words with the same hash), so the caller retries with
+// another seed.
+bool placeBuckets(const std::vector<uint64_t> &hashes, uint32_t buckets,
+                  std::vector<uint32_t> &pilots, std::vector<uint32_t> &slotWord)
+{
+    uint32_t n = (uint32_t)hashes.size();
+    std::vector<std::vector<uint32_t>> members(buckets);
+    for (uint32_t i = 0; i < n; ++i)
+        members[bucketOf(hashes[i], buckets)].push_back(i);
+
+    std::vector<uint32_t> order(buckets);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                     { return members[a].size() > members[b].size(); });
+
+    const uint32_t maxPilot = 64 * n + 1024;
+    std::vector<bool> taken(n, false);
+    std::vector<uint32_t> slots;
+    pilots.assign(buckets, 0);
+    slotWord.assign(n, 0);
+
+    for (uint32_t b : order)
+    {
+        if (members[b].empty())
+            break;
+
+        uint32_t pilot = 0;
+        for (;; ++pilot)
+        {
+            if (pilot == maxPilot)
+                return false;
+            slots.clear();
+            bool fits = true;
+            for (uint32_t w : members[b])
+            {
+                uint32_t s = slotOf(hashes[w], pilot, n);
+                if (taken[s] || std::find(slots.begin(), slots.end(), s) != slots.end())
+                {
+                    fits = false;
+                    break;
+                }
+                slots.push_back(s);
+            }
+            if (fits)
+                break;
+        }
+
+        pilots[b] = pilot;
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            taken[slots[i]] = true;
+            slotWord[slots[i]] = members[b][i];
+        }
+    }
+    return true;
+}
+} // namespace
+
+bool writeStaticLexicon(const std::vector<LexiconWord> &words, std::vector<uint8_t> &out)
+{
+    uint32_t n = (uint32_t)words.size();
+    uint32_t buckets = n ? (n + WORDS_PER_BUCKET - 1) / WORDS_PER_BUCKET : 0;
+
+    // Two copies of a word hash the same under every seed
+    std::vector<std::string_view> sorted;
+    sorted.reserve(n);
+    for (auto &w : words)
+        sorted.push_back(w.word);
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        return false;
+
+    std::vector<uint64_t> hashes(n);
+    std::vector<uint32_t> pilots, slotWord;
+    uint64_t seed = 0;
+    for (;; ++seed)
+    {
+        if (seed == MAX_SEEDS)
+            return false;
+        for (uint32_t i = 0; i < n; ++i)
+            hashes[i] = hashWord(words[i].word, seed);
+        if (placeBuckets(hashes, buckets, pilots, slotWord))
+            break;
+    }
+
+    LexiconHeader header{};
+    header.wordCount = n;
+    header.bucketCount = buckets;
+    header.seed = seed;
+    for (auto &w : words)
+        header.poolBytes += w.word.size();
+    appendPod(out, header);
+    for (uint32_t p : pilots)
+        appendPod(out, p);
+
+    uint32_t wordOffset = 0;
+    for (uint32_t s = 0; s < n; ++s)
+    {
+        const LexiconWord &w = words[slotWord[s]];
+        appendPod(out, LexEntry{wordOffset, w.wordID, w.df, w.termIndex});
+        wordOffset += (uint32_t)w.word.size();
+    }
+    appendPod(out, LexEntry{wordOffset, -1, 0, NO_TERM});
+
+    for (uint32_t s = 0; s < n; ++s)
+    {
+        const std::string &w = words[slotWord[s]].word;
+        out.insert(out.end(), w.begin(), w.end());
+    }
+    return true;
+}
+
+bool StaticLexicon::attach(const uint8_t *section, size_t size)
+{
+    LexiconHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, section, sizeof(header));
+
+    uint64_t entriesOffset = sizeof(header) + 4ull * header.bucketCount;
+    uint64_t poolOffset = entriesOffset + sizeof(LexEntry) * (header.wordCount + 1ull);
+    if (poolOffset + header.poolBytes > size || (header.wordCount && !header.bucketCount))
+        return false;
+
+    pilots = reinterpret_cast<const uint32_t *>(section + sizeof(header));
+    entries = reinterpret_cast<const LexEntry *>(section + entriesOffset);
+    pool = reinterpret_cast<const char *>(section + poolOffset);
+    numWords = header.wordCount;
+    numBuckets = header.bucketCount;
+    seed = header.seed;
+    return entries[numWords].wordOffset == header.poolBytes;
+}
+
+const LexEntry *StaticLexicon::find(std::string_view w) const
+{
+    if (numWords == 0)
+        return nullptr;
+    uint64_t hash = hashWord(w, seed);
+    uint32_t slot = slotOf(hash, pilots[bucketOf(hash, numBuckets)], numWords);
+    if (word(slot) != w)
+        return nullptr;
+    return &entries[slot];
+}
@@ -0,0 +1,74 @@
+#ifndef STATIC_LEXICON_H
+#define STATIC_LEXICON_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only word -> term lookup stored as one flat section, host byte
+// order:
+//
+//   header    wordCount, bucketCount, seed, pool size
+//   pilots    uint32 x bucketCount
+//   entries   LexEntry x wordCount in hash slot order, then one more
+//             whose wordOffset is the end of the pool
+//   pool      word bytes, in slot order
+//
+// Slots come from a minimal perfect hash (hash and displace): a word's
+// hash picks a bucket, and the bucket's pilot picks a slot with no
+// collisions inside the lexicon. A lookup is one hash, two array reads
+// and a single string compare, and the section is used in place.
+
+struct LexEntry
+{
+    uint32_t wordOffset; // into the pool; the word ends at the next entry's offset
+    int32_t wordID;
+    uint32_t df;        // documents containing the word
+    uint32_t termIndex; // position in the postings term table, NO_TERM if none
+};
+static_assert(sizeof(LexEntry) == 16, "LexEntry is stored as-is in the lexicon section");
+
+const uint32_t NO_TERM = 0xFFFFFFFFu;
+
+// Input for writeStaticLexicon; words must be distinct.
+struct LexiconWord
+{
+    std::string word;
+    int wordID = -1;
+    uint32_t df = 0;
+    uint32_t termIndex = NO_TERM;
+};
+
+// Appends the section for words to out. False, with nothing appended, if
+// two words are the same or no seed up to a limit places every word.
+bool writeStaticLexicon(const std::vector<LexiconWord> &words, std::vector<uint8_t> &out);
+
+class StaticLexicon
+{
+private:
+    const uint32_t *pilots = nullptr;
+    const LexEntry *entries = nullptr;
+    const char *pool = nullptr;
+    uint32_t numWords = 0;
+    uint32_t numBuckets = 0;
+    uint64_t seed = 0;
+
+public:
+    // Points the lexicon at a section written by writeStaticLexicon;
+    // the bytes must stay valid while it is used.
+    bool attach(const uint8_t *section, size_t size);
+
+    // Words in slot order
+    size_t size() const { return numWords; }
+    const LexEntry &entry(size_t slot) const { return entries[slot]; }
+    std::string_view word(size_t slot) const
+    {
+        return std::string_view(pool + entries[slot].wordOffset,
+                                entries[slot + 1].wordOffset - entries[slot].wordOffset);
+    }
+
+    const LexEntry *find(std::string_view word) const; // nullptr if missing
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "term_cursor.h"
+#include <algorithm>
+
+TermCursor::TermCursor(const SegmentedIndex &index, std::string_view term, const Bm25 &bm25)
+{
+    for (size_t s = 0; s < index.segmentCount(); ++s)
+        if (const TermEntry *entry = index.segment(s).term(term))
+            docFreq += entry->df;
+    idf = bm25.idf(docFreq);
+
+    for (size_t s = 0; s < index.segmentCount(); ++s)
+    {
+        const IndexImage &segment = index.segment(s);
+        const TermEntry *entry = segment.term(term);
+        if (!entry || segment.docCount() == 0)
+            continue;
+        const PostingBlock *block = segment.blocks(*entry);
+        uint32_t prevDoc = 0;
+        for (uint32_t first = 0; first < entry->df && (first == 0 || prevDoc < segment.docCount());
+             first += BITPACK_BLOCK, ++block)
+        {
+            uint32_t last = std::min<uint32_t>(block->lastDoc, (uint32_t)segment.docCount() - 1);
+            const FieldBlock &fieldBlock = segment.fieldBlock(block);
+            double bound = bm25.termScore(fieldBlock.maxFreq, fieldBlock.minLength, idf);
+            blocks.push_back({&segment, entry, block, index.docBase(s), first, prevDoc,
+                              index.docBase(s) + last, bound});
+            maxScore = std::max(maxScore, bound);
+            prevDoc = block->lastDoc;
+        }
+    }
+    load(0);
+}
+
+uint32_t TermCursor::blockSize(const BlockRef &r) const
+{
+    return std::min<uint32_t>(BITPACK_BLOCK, r.entry->df - r.first);
+}
+
+// Decodes the first block from b on that has a doc of its segment
+void TermCursor::load(size_t b)
+{
+    for (; b < blocks.size(); ++b)
+    {
+        const BlockRef &r = blocks[b];
+        const PostingsReader &postings = r.segment->postings();
+        count = blockSize(r);
+        decodeStream(postings.getCodec(), postings.termData(*r.entry) + r.block->docOffset, count, docs);
+        uint32_t doc = r.prevDoc;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            doc += docs[i];
+            docs[i] = doc;
+        }
+        while (count > 0 && docs[count - 1] >= r.segment->docCount())
+            --count; // past the segment's docs: a damaged list
+        if (count > 0)
+        {
+            current = b;
+            pos = 0;
+            freqsDecoded = false;
+            positionsAt = nullptr;
+            positionsPos = 0;
+            currentDoc = r.base + docs[0];
+            return;
+        }
+    }
+    current = blocks.size();
+    currentDoc = END_DOC;
+}
+
+double TermCursor::score(const Bm25 &bm25)
+{
+    const BlockRef &r = blocks[current];
+    if (!freqsDecoded)
+    {
+        readFieldFreqs(r.segment->postings().getCodec(), r.segment->blockFieldFreqs(r.block), blockSize(r),
+                       fieldFreqs);
+        freqsDecoded = true;
+    }
+    uint32_t freqs[SCORED_FIELDS];
+    for (int f = 0; f < SCORED_FIELDS; ++f)
+        freqs[f] = fieldFreqs[f][pos];
+    return bm25.termScore(freqs, r.segment->fieldLengths(docs[pos]), idf);
+}
+
+bool TermCursor::positions(std::vector<uint32_t> &out)
+{
+    if (!positionsAt)
+    {
+        const BlockRef &r = blocks[current];
+        positionsAt = r.segment->blockPositions(r.block);
+        if (!positionsAt)
+            return false;
+    }
+    for (; positionsPos < pos; ++positionsPos)
+        positionsAt = skipPositions(positionsAt);
+    readPositions(positionsAt, out);
+    return !out.empty();
+}
+
+void TermCursor::next()
+{
+    if (++pos < count)
+        currentDoc = blocks[current].base + docs[pos];
+    else
+        load(current + 1);
+}
+
+void TermCursor::seek(uint32_t target)
+{
+    while (currentDoc < target)
+    {
+        if (blocks[current].lastDoc < target)
+        {
+            // Gallop to a block range that ends at or after target, then
+            // binary search it
+            size_t lo = current + 1, step = 1, hi = lo;
+            while (hi < blocks.size() && blocks[hi].lastDoc < target)
+            {
+                lo = hi + 1;
+                hi += step;
+                step *= 2;
+            }
+            hi = std::min(hi + 1, blocks.size());
+            lo = std::partition_point(blocks.begin() + lo, blocks.begin() + hi,
+                                      [&](const BlockRef &r) { return r.lastDoc < target; }) -
+                 blocks.begin();
+            load(lo);
+            continue;
+        }
+
+        // The same within the decoded block
+        uint32_t local = target - blocks[current].base;
+        uint32_t lo = pos + 1, step = 1, hi = lo;
+        while (hi < count && docs[hi] < local)
+        {
+            lo = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        hi = std::min(hi + 1, count);
+        pos = (uint32_t)(std::lower_bound(docs + lo, docs + hi, local) - docs);
+        if (pos < count)
+            currentDoc = blocks[current].base + docs[pos];
+        else
+            load(current + 1); // a damaged block: its last doc was past its postings
+    }
+}
+
+double TermCursor::blockMax(uint32_t target)
+{
+    shallowBlock = std::max(shallowBlock, current);
+    while (shallowBlock < blocks.size() && blocks[shallowBlock].lastDoc < target)
+        ++shallowBlock;
+    return shallowBlock < blocks.size() ? blocks[shallowBlock].maxScore : 0.0;
+}
@@ -0,0 +1,79 @@
+#ifndef TERM_CURSOR_H
+#define TERM_CURSOR_H
+
+#include "retrieval.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Past the last doc: where a cursor stops
+const uint32_t END_DOC = UINT32_MAX;
+
+// Walks one term's postings across all segments of a SegmentedIndex in
+// global doc number order. Postings are decoded a PostingBlock at a time
+// and only when a doc in the block is needed; seek() gallops over the
+// blocks' last docs and then over the decoded docs, so skipping far
+// ahead reads a few block headers instead of the postings in between.
+class TermCursor
+{
+private:
+    // One block of the term's list in some segment, doc numbers global
+    struct BlockRef
+    {
+        const IndexImage *segment;
+        const TermEntry *entry;
+        const PostingBlock *block;
+        uint32_t base;    // the segment's first doc number
+        uint32_t first;   // index in the list of the block's first posting
+        uint32_t prevDoc; // local doc before the block, where its gaps start
+        uint32_t lastDoc;
+        double maxScore;
+    };
+
+    std::vector<BlockRef> blocks;
+    size_t current = 0;      // decoded block
+    size_t shallowBlock = 0; // block last used for a bound
+    uint32_t docs[BITPACK_BLOCK];
+    uint32_t fieldFreqs[SCORED_FIELDS][BITPACK_BLOCK];
+    uint32_t count = 0;
+    uint32_t pos = 0;
+    bool freqsDecoded = false;
+    uint32_t currentDoc = END_DOC;
+    const uint8_t *positionsAt = nullptr; // into the block's positions, once needed
+    uint32_t positionsPos = 0;            // the posting positionsAt starts
+
+    uint32_t blockSize(const BlockRef &r) const;
+    void load(size_t b);
+
+public:
+    double idf = 0.0;       // from the df over all segments
+    double maxScore = 0.0;  // BM25F bound over all blocks
+    uint32_t docFreq = 0;   // over all segments
+
+    TermCursor(const SegmentedIndex &index, std::string_view term, const Bm25 &bm25);
+
+    uint32_t doc() const { return currentDoc; }
+    // BM25F of the current doc; the block's field freqs are decoded on
+    // the first call in it
+    double score(const Bm25 &bm25);
+    uint32_t docLength() const { return blocks[current].segment->docLength(docs[pos]); }
+
+    // The term's positions in the current doc, ascending; false if they
+    // are not known (its segment has no positions, or none for the doc).
+    // The block's positions are only read from here, and postings before
+    // this one in the block are skipped over.
+    bool positions(std::vector<uint32_t> &out);
+
+    void next();
+
+    // Moves to the first doc >= target
+    void seek(uint32_t target);
+
+    // Best score of the block that would hold target, without decoding
+    // it; blockEnd() is then that block's last doc. Targets must not
+    // go backwards.
+    double blockMax(uint32_t target);
+    uint32_t blockEnd() const { return shallowBlock < blocks.size() ? blocks[shallowBlock].lastDoc : END_DOC; }
+};
+
+#endif
@@ -1,54 +1,84 @@
 #include "text_normalizer.h"
-#include <regex>
-#include <algorithm>
-#include <cctype>
+#include <array>
 
+namespace
+{
+// What one input byte turns into. The table folds the old chain of
+// regex passes into a single lookup:
+//   lowercase, pad @ # + * / = < > ( ) $ with spaces, drop ' and ,
+//   keep a-z 0-9 and the UTF-8 bytes of ä ö ü ß, turn everything else
+//   (hyphens, decimal points, other punctuation, whitespace) into a
+//   separator, then collapse separators to single spaces and trim.
+enum ByteClass : unsigned char
+{
+    SEPARATOR,
+    KEEP,
+    DROP,
+    PAD,
+};
 
-std::string TextNormalizer::normalize(const std::string &text) {
-    if (text.empty()) return "";
-
-    std::string s = text;
-
-    // 2. Lowercase
-    std::transform(s.begin(), s.end(), s.begin(),
-                   [](unsigned char c){ return std::tolower(c); });
-
-    // 3. Separate @ and #
-    s = std::regex_replace(s, std::regex("([@#])"), " $1 ");
-
-    // 4. Remove apostrophes
-    s.erase(std::remove(s.begin(), s.end(), '\''), s.end());
-
-    // 5. Tokenize math operators and parentheses
-    s = std::regex_replace(s, std::regex("([+\\-*/=<>])"), " $1 ");
-    s = std::regex_replace(s, std::regex("([()])"), " $1 ");
-
-    // 6. Tokenize dollar sign
-    s = std::regex_replace(s, std::regex("\\$"), " $ ");
+struct ByteTable
+{
+    std::array<ByteClass, 256> cls;
+    std::array<char, 256> out;
 
-    // 7. Replace decimal numbers (12.34 → 12 34)
-    s = std::regex_replace(s, std::regex("(\\d+)\\.(\\d+)"), "$1 $2");
+    ByteTable()
+    {
+        for (int c = 0; c < 256; ++c)
+        {
+            cls[c] = SEPARATOR;
+            out[c] = (char)c;
+        }
+        for (int c = 'a'; c <= 'z'; ++c)
+            cls[c] = KEEP;
+        for (int c = 'A'; c <= 'Z'; ++c)
+        {
+            cls[c] = KEEP;
+            out[c] = (char)(c - 'A' + 'a');
+        }
+        for (int c = '0'; c <= '9'; ++c)
+            cls[c] = KEEP;
+        // ä = C3 A4, ö = C3 B6, ü = C3 BC, ß = C3 9F, allowed byte by byte
+        for (int c : {0xC3, 0xA4, 0xB6, 0xBC, 0x9F})
+            cls[c] = KEEP;
+        for (char c : {'@', '#', '+', '*', '/', '=', '<', '>', '(', ')', '$'})
+            cls[(unsigned char)c] = PAD;
+        cls[(unsigned char)'\''] = DROP;
+        cls[(unsigned char)','] = DROP;
+    }
+};
 
-    // Remove commas inside numbers
-    s = std::regex_replace(s, std::regex(","), "");
+const ByteTable table;
+} // namespace
 
-    // 8. Remove all other punctuation
-    // Allow: a-z 0-9 space + - * / = < > ( ) $ @ # ä ö ü ß
-    s = std::regex_replace(
-        s,
-        std::regex("[^a-z0-9\\s+\\-*/=<>()\\$@#äöüß]"),
-        " "
-    );
-
-    // 9. Split hyphenated words
-    s = std::regex_replace(s, std::regex("\\s*-\\s*"), " ");
-
-    // 10. Collapse multiple spaces
-    s = std::regex_replace(s, std::regex("\\s+"), " ");
+std::string TextNormalizer::normalize(const std::string &text) {
+    std::string s;
+    normalize(text, s);
+    return s;
+}
 
-    // Trim leading/trailing space
-    if (!s.empty() && s.front() == ' ') s.erase(0, 1);
-    if (!s.empty() && s.back() == ' ') s.pop_back();
+void TextNormalizer::normalize(const std::string &text, std::string &s) {
+    s.clear();
+    s.reserve(text.size());
 
-    return s;
+    bool pendingSpace = false; // a separator was seen since the last output byte
+    for (unsigned char c : text) {
+        switch (table.cls[c]) {
+        case KEEP:
+            if (pendingSpace && !s.empty()) s += ' ';
+            pendingSpace = false;
+            s += table.out[c];
+            break;
+        case PAD:
+            if (!s.empty()) s += ' ';
+            s += (char)c;
+            pendingSpace = true;
+            break;
+        case SEPARATOR:
+            pendingSpace = true;
+            break;
+        case DROP:
+            break;
+        }
+    }
 }
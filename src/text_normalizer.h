@@ -3,10 +3,17 @@
 
 #include <string>
 
+// Lowercases and strips punctuation the same way as data_to_info.py's
+// TextNormalizer (identical output for ASCII text). Works on bytes in
+// a single pass; non-ASCII bytes other than those of ä ö ü ß become
+// separators.
 class TextNormalizer
 {
 public:
     static std::string normalize(const std::string &text);
+
+    // Same, written into out so a caller can reuse its buffer.
+    static void normalize(const std::string &text, std::string &out);
 };
 
 #endif
@@ -1,12 +1,219 @@
 #include "tokenizer.h"
-#include <sstream>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Both tokenizers classify 64 bytes at a time into a bit mask (bit i set
+// = byte i is part of a token), with AVX2 (2 x 32 bytes), SSE2 (4 x 16)
+// or plain loops, then walk the mask's 0->1 and 1->0 edges to emit
+// tokens. Build with -mavx2 to get the AVX2 path.
+
+namespace
+{
+const size_t BLOCK = 64;
+
+inline int lowestBit(uint64_t m)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, m);
+    return (int)i;
+#else
+    return __builtin_ctzll(m);
+#endif
+}
+
+inline bool isUpper(unsigned char c) { return c >= 'A' && c <= 'Z'; }
+inline bool isLower(unsigned char c) { return c >= 'a' && c <= 'z'; }
+inline bool isSpace(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+// Letters: lowercases n (<= 64) bytes from src into dst and returns
+// the letter mask.
+uint64_t lowerBlockScalar(const char *src, char *dst, size_t n)
+{
+    uint64_t m = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char c = (unsigned char)src[i];
+        c = isUpper(c) ? (unsigned char)(c | 0x20) : c;
+        dst[i] = (char)c;
+        m |= (uint64_t)isLower(c) << i;
+    }
+    return m;
+}
+
+uint64_t wordBlockScalar(const char *src, size_t n)
+{
+    uint64_t m = 0;
+    for (size_t i = 0; i < n; ++i)
+        m |= (uint64_t)!isSpace((unsigned char)src[i]) << i;
+    return m;
+}
+
+#if defined(__AVX2__)
+
+inline __m256i inRange(__m256i v, char lo, char hi)
+{
+    // Signed compares: bytes >= 0x80 are negative and never in range
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+uint64_t lowerBlock(const char *src, char *dst)
+{
+    uint64_t m = 0;
+    for (int k = 0; k < 2; ++k)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32 * k));
+        __m256i upper = inRange(v, 'A', 'Z');
+        v = _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32 * k), v);
+        m |= (uint64_t)(uint32_t)_mm256_movemask_epi8(inRange(v, 'a', 'z')) << (32 * k);
+    }
+    return m;
+}
+
+uint64_t wordBlock(const char *src)
+{
+    uint64_t m = 0;
+    for (int k = 0; k < 2; ++k)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32 * k));
+        __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange(v, '\t', '\r'));
+        m |= (uint64_t)(uint32_t)~_mm256_movemask_epi8(space) << (32 * k);
+    }
+    return m;
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+inline __m128i inRange(__m128i v, char lo, char hi)
+{
+    // Signed compares: bytes >= 0x80 are negative and never in range
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+uint64_t lowerBlock(const char *src, char *dst)
+{
+    uint64_t m = 0;
+    for (int k = 0; k < 4; ++k)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16 * k));
+        __m128i upper = inRange(v, 'A', 'Z');
+        v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16 * k), v);
+        m |= (uint64_t)_mm_movemask_epi8(inRange(v, 'a', 'z')) << (16 * k);
+    }
+    return m;
+}
+
+uint64_t wordBlock(const char *src)
+{
+    uint64_t m = 0;
+    for (int k = 0; k < 4; ++k)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16 * k));
+        __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange(v, '\t', '\r'));
+        m |= (uint64_t)(uint16_t)~_mm_movemask_epi8(space) << (16 * k);
+    }
+    return m;
+}
+
+#else
+
+uint64_t lowerBlock(const char *src, char *dst) { return lowerBlockScalar(src, dst, BLOCK); }
+uint64_t wordBlock(const char *src) { return wordBlockScalar(src, BLOCK); }
+
+#endif
+
+// Walks the token mask of one block. A token may continue from the
+// previous block (inToken/start carry over).
+struct EdgeWalker
+{
+    const char *base;
+    std::vector<std::string_view> &tokens;
+    bool inToken = false;
+    size_t start = 0;
+    uint64_t prevTop = 0; // last bit of the previous block's mask
+
+    void block(size_t offset, uint64_t m)
+    {
+        uint64_t shifted = (m << 1) | prevTop;
+        uint64_t starts = m & ~shifted;
+        uint64_t ends = ~m & shifted;
+        prevTop = m >> 63;
+
+        // Starts and ends alternate, so take them in turn
+        while (true)
+        {
+            if (inToken)
+            {
+                if (!ends)
+                    break;
+                size_t end = offset + lowestBit(ends);
+                ends &= ends - 1;
+                tokens.emplace_back(base + start, end - start);
+                inToken = false;
+            }
+            else
+            {
+                if (!starts)
+                    break;
+                start = offset + lowestBit(starts);
+                starts &= starts - 1;
+                inToken = true;
+            }
+        }
+    }
+
+    void finish(size_t size)
+    {
+        if (inToken)
+            tokens.emplace_back(base + start, size - start);
+    }
+};
+} // namespace
+
+void tokenizeWords(std::string_view text, std::string &lowered, std::vector<std::string_view> &tokens)
+{
+    tokens.clear();
+    lowered.resize(text.size());
+    char *dst = &lowered[0];
+    EdgeWalker walker{lowered.data(), tokens};
+
+    size_t i = 0;
+    for (; i + BLOCK <= text.size(); i += BLOCK)
+        walker.block(i, lowerBlock(text.data() + i, dst + i));
+    if (i < text.size())
+        walker.block(i, lowerBlockScalar(text.data() + i, dst + i, text.size() - i));
+    walker.finish(text.size());
+}
+
+void splitWhitespace(std::string_view text, std::vector<std::string_view> &tokens)
+{
+    tokens.clear();
+    EdgeWalker walker{text.data(), tokens};
+
+    size_t i = 0;
+    for (; i + BLOCK <= text.size(); i += BLOCK)
+        walker.block(i, wordBlock(text.data() + i));
+    if (i < text.size())
+        walker.block(i, wordBlockScalar(text.data() + i, text.size() - i));
+    walker.finish(text.size());
+}
 
 std::vector<std::string> tokenize(const std::string &text)
 {
-    std::vector<std::string> tokens;
-    std::stringstream ss(text);
-    std::string word;
-    while (ss >> word)
-        tokens.push_back(word);
-    return tokens;
+    std::string lowered;
+    std::vector<std::string_view> views;
+    tokenizeWords(text, lowered, views);
+    return std::vector<std::string>(views.begin(), views.end());
 }
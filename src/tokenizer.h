@@ -2,8 +2,21 @@
 #define TOKENIZER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Splits text into maximal runs of ASCII letters, lowercased (the same
+// words the search server looks up). lowered receives text with A-Z
+// lowercased; tokens are views into it and stay valid until lowered is
+// next modified. Both buffers are reused, so a caller that keeps them
+// does not allocate per token.
+void tokenizeWords(std::string_view text, std::string &lowered, std::vector<std::string_view> &tokens);
+
+// Whitespace-separated tokens, unchanged, as views into text. For text
+// that TextNormalizer has already split.
+void splitWhitespace(std::string_view text, std::vector<std::string_view> &tokens);
+
+// tokenizeWords, copied out.
 std::vector<std::string> tokenize(const std::string &text);
 
 #endif
@@ -0,0 +1,287 @@
+// topKBlockMaxWand and topKBoolean (an OR of words) against
+// topKExhaustive: the same docs with the same scores, for random
+// queries over a three-segment random index, once per postings codec,
+// with varying k and field weights. Then times each strategy on queries
+// of several frequent words, and of a frequent word with rare ones.
+// Exits non-zero on a mismatch.
+
+#include "../src/query_parser.h"
+#include "../src/retrieval.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+const uint32_t VOCABULARY = 5000;
+const uint32_t SEGMENT_DOCS[] = {6000, 2500, 800};
+
+// Letters only, as the query parser splits words at anything else
+std::string wordName(uint32_t w)
+{
+    std::string name = "w";
+    do
+    {
+        name += (char)('a' + w % 26);
+        w /= 26;
+    } while (w > 0);
+    return name;
+}
+
+// A doc's words with their freq in each ScoredField, by wordID
+struct DocWord
+{
+    uint32_t word;
+    uint32_t freqs[SCORED_FIELDS];
+};
+
+// Writes one segment of count random docs into dir. Word w is drawn
+// with probability about 1 / (w + 1), so low IDs are in most docs.
+bool writeSegment(const std::string &dir, uint32_t count, uint32_t firstDoc, PostingsCodec codec,
+                  std::mt19937 &rng)
+{
+    static std::vector<double> cdf;
+    if (cdf.empty())
+    {
+        double sum = 0;
+        for (uint32_t w = 0; w < VOCABULARY; ++w)
+            cdf.push_back(sum += 1.0 / (w + 1));
+    }
+    std::uniform_real_distribution<double> draw(0, cdf.back());
+    std::uniform_int_distribution<int> titleLength(0, 12), abstractLength(0, 120), bodyLength(20, 300);
+
+    std::vector<PostingList> lists(VOCABULARY);
+    std::vector<std::vector<DocWord>> docWords(count);
+    std::vector<ImageDoc> docs(count);
+    std::vector<std::string> names;
+    std::vector<uint32_t> seen(VOCABULARY, UINT32_MAX);
+    for (uint32_t d = 0; d < count; ++d)
+    {
+        int lengths[SCORED_FIELDS] = {titleLength(rng), abstractLength(rng), bodyLength(rng)};
+        std::vector<DocWord> &words = docWords[d];
+        for (int f = 0; f < SCORED_FIELDS; ++f)
+        {
+            for (int i = 0; i < lengths[f]; ++i)
+            {
+                uint32_t w = (uint32_t)(std::lower_bound(cdf.begin(), cdf.end(), draw(rng)) - cdf.begin());
+                if (seen[w] != d)
+                {
+                    seen[w] = d;
+                    words.push_back({w, {0, 0, 0}});
+                }
+                auto it = std::find_if(words.begin(), words.end(), [&](const DocWord &dw) { return dw.word == w; });
+                ++it->freqs[f];
+            }
+            docs[d].fieldLengths[f] = (uint32_t)lengths[f];
+            docs[d].length += (uint32_t)lengths[f];
+        }
+        std::sort(words.begin(), words.end(), [](const DocWord &a, const DocWord &b) { return a.word < b.word; });
+        for (const DocWord &dw : words)
+        {
+            lists[dw.word].docs.push_back(d);
+            lists[dw.word].freqs.push_back(dw.freqs[0] + dw.freqs[1] + dw.freqs[2]);
+            lists[dw.word].fields.push_back(dw.freqs[0] ? 1 : dw.freqs[1] ? 2 : 3);
+        }
+        names.push_back("d" + std::to_string(firstDoc + d));
+        docs[d].fields[DOC_CORD_ID] = names.back();
+    }
+
+    std::string tmpPath = newSegmentPath(dir);
+    std::string postingsPath = tmpPath + ".postings";
+    {
+        PostingsWriter writer(postingsPath, codec);
+        for (uint32_t w = 0; w < VOCABULARY; ++w)
+            if (!lists[w].docs.empty())
+                writer.addTerm((int)w, lists[w]);
+        writer.finish(names);
+    }
+    std::ifstream in(postingsPath, std::ios::binary);
+    std::vector<uint8_t> postingsFile((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    fs::remove(postingsPath);
+
+    std::vector<std::pair<std::string, int>> lexicon;
+    for (uint32_t w = 0; w < VOCABULARY; ++w)
+        lexicon.emplace_back(wordName(w), (int)w);
+    auto fieldFreqs = [&](int wordID, uint32_t doc, uint32_t *out)
+    {
+        const std::vector<DocWord> &words = docWords[doc];
+        auto it = std::lower_bound(words.begin(), words.end(), (uint32_t)wordID,
+                                   [](const DocWord &dw, uint32_t w) { return dw.word < w; });
+        std::copy(it->freqs, it->freqs + SCORED_FIELDS, out);
+        return true;
+    };
+    return writeIndexImage(tmpPath, lexicon, postingsFile, docs, nullptr, fieldFreqs) &&
+           commitSegment(dir, tmpPath, count);
+}
+
+bool same(const std::vector<ScoredDoc> &a, const std::vector<ScoredDoc> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].doc != b[i].doc || a[i].score != b[i].score)
+            return false;
+    return true;
+}
+
+void orQuery(const std::vector<std::string> &words, QueryNode &node)
+{
+    std::string query;
+    for (const std::string &w : words)
+        query += (query.empty() ? "" : " ") + w;
+    parseQuery(query, node);
+}
+
+Bm25 defaults(const SegmentedIndex &index)
+{
+    Bm25 bm25;
+    bm25.docCount = index.docCount();
+    bm25.avgDocLength = index.avgDocLength();
+    for (int f = 0; f < SCORED_FIELDS; ++f)
+        bm25.avgFieldLength[f] = index.avgFieldLength(f);
+    return bm25;
+}
+
+// Random queries of 1 to 5 distinct words, frequent, mid or rare
+int checkQueries(const SegmentedIndex &index, std::mt19937 &rng, size_t &queries)
+{
+    const size_t ks[] = {1, 10, 20, 100};
+    const double weightSets[][SCORED_FIELDS] = {{3, 1.5, 1}, {1, 1, 1}, {10, 0, 0.5}, {0, 0, 1}, {0.2, 4, 0}};
+    int failures = 0;
+    std::vector<ScoredDoc> exhaustive, wand, boolean;
+    for (int q = 0; q < 1500; ++q)
+    {
+        Bm25 bm25 = defaults(index);
+        std::copy(weightSets[q % 5], weightSets[q % 5] + SCORED_FIELDS, bm25.fieldWeight);
+        size_t k = ks[(q / 5) % 4];
+
+        std::vector<std::string> words;
+        for (int n = 1 + (int)(rng() % 5); n > 0; --n)
+        {
+            uint32_t range = rng() % 3 == 0 ? 20 : rng() % 2 == 0 ? 500 : VOCABULARY;
+            std::string w = wordName(rng() % range);
+            if (std::find(words.begin(), words.end(), w) == words.end())
+                words.push_back(w);
+        }
+        std::vector<std::string_view> terms(words.begin(), words.end());
+        QueryNode node;
+        orQuery(words, node);
+
+        topKExhaustive(index, terms, bm25, k, exhaustive);
+        topKBlockMaxWand(index, terms, bm25, k, wand);
+        topKBoolean(index, node, bm25, k, boolean);
+        std::string text = words[0];
+        for (size_t i = 1; i < words.size(); ++i)
+            text += " " + words[i];
+        if (!same(exhaustive, wand))
+        {
+            std::printf("FAIL topKBlockMaxWand \"%s\" k=%zu\n", text.c_str(), k);
+            ++failures;
+        }
+        if (!same(exhaustive, boolean))
+        {
+            std::printf("FAIL topKBoolean \"%s\" k=%zu\n", text.c_str(), k);
+            ++failures;
+        }
+        ++queries;
+    }
+    return failures;
+}
+
+// Milliseconds per query for each strategy over 200 queries, top 20:
+// 2 to 5 of the 30 most frequent words, then one of those with 1 to 3
+// words outside the 500 most frequent
+void timeQueries(const SegmentedIndex &index, bool withRare, std::mt19937 &rng)
+{
+    Bm25 bm25 = defaults(index);
+    std::vector<std::vector<std::string>> queries;
+    while (queries.size() < 200)
+    {
+        std::vector<std::string> words;
+        for (size_t n = 2 + queries.size() % (withRare ? 3 : 4); words.size() < n;)
+        {
+            uint32_t w = words.empty() || !withRare ? rng() % 30 : 500 + rng() % (VOCABULARY - 500);
+            if (std::find(words.begin(), words.end(), wordName(w)) == words.end())
+                words.push_back(wordName(w));
+        }
+        queries.push_back(words);
+    }
+
+    std::vector<ScoredDoc> out;
+    double ms[3] = {};
+    for (int strategy = 0; strategy < 3; ++strategy)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (const std::vector<std::string> &words : queries)
+        {
+            std::vector<std::string_view> terms(words.begin(), words.end());
+            if (strategy == 0)
+                topKExhaustive(index, terms, bm25, 20, out);
+            else if (strategy == 1)
+                topKBlockMaxWand(index, terms, bm25, 20, out);
+            else
+            {
+                QueryNode node;
+                orQuery(words, node);
+                topKBoolean(index, node, bm25, 20, out);
+            }
+        }
+        ms[strategy] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+                       queries.size();
+    }
+    std::printf("  %-22s exhaustive %.3f ms, block-max WAND %.3f ms, boolean OR %.3f ms\n",
+                withRare ? "1 frequent + 1-3 rare:" : "2-5 frequent words:", ms[0], ms[1], ms[2]);
+}
+} // namespace
+
+int main()
+{
+    int failures = 0;
+    const PostingsCodec codecs[] = {PostingsCodec::VByte, PostingsCodec::BitPacked};
+    for (PostingsCodec codec : codecs)
+    {
+        const char *codecName = codec == PostingsCodec::VByte ? "vbyte" : "bitpack";
+        std::string dir = (fs::temp_directory_path() / (std::string("block_max_wand_test_") + codecName)).string();
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+
+        std::mt19937 rng(2024);
+        uint32_t firstDoc = 0;
+        for (uint32_t count : SEGMENT_DOCS)
+        {
+            if (!writeSegment(dir, count, firstDoc, codec, rng))
+            {
+                std::printf("cannot write a segment in %s\n", dir.c_str());
+                return 1;
+            }
+            firstDoc += count;
+        }
+
+        {
+            SegmentedIndex index;
+            if (!index.open(dir) || index.segmentCount() != 3)
+            {
+                std::printf("cannot open %s\n", dir.c_str());
+                return 1;
+            }
+            size_t queries = 0;
+            int codecFailures = checkQueries(index, rng, queries);
+            std::printf("%s: %zu random queries, %d failures\n", codecName, queries, codecFailures);
+            timeQueries(index, false, rng);
+            timeQueries(index, true, rng);
+            failures += codecFailures;
+        }
+        fs::remove_all(dir);
+    }
+    return failures == 0 ? 0 : 1;
+}
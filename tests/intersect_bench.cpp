@@ -0,0 +1,141 @@
+// intersectSorted against the scalar merge and std::set_intersection on
+// pairs of real posting lists, bucketed by length ratio, in ns per input
+// doc (best of 7). The last column is a two-word AND the way
+// search_main used to run it: the list of every doc intersected with
+// each word in turn, instead of starting from the shorter list. Every
+// pair is also checked against std::set_intersection; exits non-zero
+// on a mismatch.
+//
+// Usage: intersect_bench [postings.bin] (default: data/postings.bin)
+
+#include "../src/intersect.h"
+#include "../src/postings_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using List = std::vector<uint32_t>;
+
+struct Pair
+{
+    const List *a;
+    const List *b;
+};
+
+// Best of 7 runs of op over every pair, in ns per input doc
+template <typename Op>
+double nsPerDoc(const std::vector<Pair> &pairs, Op op)
+{
+    size_t docs = 0;
+    for (const Pair &p : pairs)
+        docs += p.a->size() + p.b->size();
+    double best = 1e30;
+    size_t sink = 0;
+    for (int run = 0; run < 7; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < 20; ++repeat)
+            for (const Pair &p : pairs)
+                sink += op(*p.a, *p.b);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / 20 / docs);
+    }
+    if (sink == 1) // keeps the work from being optimized away
+        std::printf(" ");
+    return best;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : "data/postings.bin";
+    PostingsReader postings;
+    if (!postings.load(path))
+    {
+        std::printf("cannot open %s\n", path.c_str());
+        return 1;
+    }
+
+    std::vector<List> lists;
+    for (size_t i = 0; i < postings.termCount(); ++i)
+    {
+        List docs;
+        postings.readDocs(postings.entry(i), docs);
+        if (docs.size() >= 4)
+            lists.push_back(std::move(docs));
+    }
+    uint32_t docCount = (uint32_t)postings.docCount();
+    List allDocs(docCount);
+    for (uint32_t d = 0; d < docCount; ++d)
+        allDocs[d] = d;
+
+    // Random pairs, shorter list first, up to 500 per ratio bucket
+    const char *bucketNames[] = {"1", "2-3", "4-7", "8-15", "16+"};
+    const int BUCKETS = 5;
+    std::vector<Pair> buckets[BUCKETS];
+    std::mt19937 rng(2024);
+    for (int tries = 0; tries < 1000000 && !lists.empty(); ++tries)
+    {
+        const List *a = &lists[rng() % lists.size()];
+        const List *b = &lists[rng() % lists.size()];
+        if (a == b)
+            continue;
+        if (a->size() > b->size())
+            std::swap(a, b);
+        size_t ratio = b->size() / a->size();
+        int bucket = ratio < 2 ? 0 : ratio < 4 ? 1 : ratio < 8 ? 2 : ratio < 16 ? 3 : 4;
+        if (buckets[bucket].size() < 500)
+            buckets[bucket].push_back({a, b});
+    }
+
+    int failures = 0;
+    List out, want;
+    for (auto &bucket : buckets)
+        for (const Pair &p : bucket)
+        {
+            out.resize(p.a->size());
+            out.resize(intersectSorted(p.a->data(), p.a->size(), p.b->data(), p.b->size(), out.data()));
+            want.clear();
+            std::set_intersection(p.a->begin(), p.a->end(), p.b->begin(), p.b->end(), std::back_inserter(want));
+            failures += out != want;
+        }
+
+    // Every version writes into buffers sized once, so none pays for
+    // growing or zero-filling its output
+    List buffer(docCount), stepBuffer(docCount);
+    std::printf("%zu lists of 4+ docs, %u docs\n", lists.size(), docCount);
+    std::printf("ratio   pairs  set_intersection  scalar  intersectSorted  AND from all docs\n");
+    for (int k = 0; k < BUCKETS; ++k)
+    {
+        const std::vector<Pair> &pairs = buckets[k];
+        if (pairs.empty())
+            continue;
+        double stl = nsPerDoc(pairs, [&](const List &a, const List &b)
+                              {
+                                  return (size_t)(std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                                                                        buffer.begin()) -
+                                                  buffer.begin());
+                              });
+        double scalar = nsPerDoc(pairs, [&](const List &a, const List &b)
+                                 { return intersectScalar(a.data(), a.size(), b.data(), b.size(), buffer.data()); });
+        double sorted = nsPerDoc(pairs, [&](const List &a, const List &b)
+                                 { return intersectSorted(a.data(), a.size(), b.data(), b.size(), buffer.data()); });
+        double fromAll = nsPerDoc(pairs, [&](const List &a, const List &b)
+                                  {
+                                      size_t n = intersectSorted(allDocs.data(), allDocs.size(), b.data(), b.size(),
+                                                                 stepBuffer.data());
+                                      return intersectSorted(stepBuffer.data(), n, a.data(), a.size(), buffer.data());
+                                  });
+        std::printf("%-6s %6zu  %16.2f  %6.2f  %15.2f  %17.2f\n", bucketNames[k], pairs.size(), stl, scalar, sorted,
+                    fromAll);
+    }
+    std::printf("%d mismatches\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+// Phrase and NEAR matching (topKBoolean) against a brute force over the
+// word positions, on a small random index. Operands may repeat a word or
+// share one with a phrase operand, and phrase operands may be sloppy:
+// one occurrence of a word can only count for one operand, so
+// "alpha NEAR alpha" needs two alphas.
+// Exits non-zero on a mismatch.
+
+#include "../src/query_parser.h"
+#include "../src/retrieval.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+const char *const WORDS[] = {"alpha", "beta", "gamma", "delta"};
+const int VOCABULARY = 4;
+
+struct Span
+{
+    uint32_t start;
+    uint32_t end;
+};
+
+// An operand: one word, or two words in order with at most slop others
+// between them
+struct Operand
+{
+    std::vector<int> words;
+    uint32_t slop = 0;
+};
+
+std::string text(const Operand &op)
+{
+    if (op.words.size() == 1)
+        return WORDS[op.words[0]];
+    std::string phrase = std::string("\"") + WORDS[op.words[0]] + " " + WORDS[op.words[1]] + "\"";
+    return op.slop > 0 ? phrase + "~" + std::to_string(op.slop) : phrase;
+}
+
+std::vector<Span> spans(const std::vector<int> &doc, const Operand &op)
+{
+    std::vector<Span> out;
+    for (uint32_t p = 0; p < doc.size(); ++p)
+    {
+        if (doc[p] != op.words[0])
+            continue;
+        if (op.words.size() == 1)
+        {
+            out.push_back({p, p});
+            continue;
+        }
+        for (uint32_t q = p + 1; q < doc.size() && q - p - 1 <= op.slop; ++q)
+            if (doc[q] == op.words[1])
+                out.push_back({p, q});
+    }
+    return out;
+}
+
+// Every choice of one span per operand; ordered needs each after the
+// one before, otherwise no two may overlap
+bool bruteForce(const std::vector<int> &doc, const std::vector<Operand> &ops, bool ordered, uint32_t slop)
+{
+    std::vector<std::vector<Span>> all;
+    uint32_t totalLength = 0;
+    for (const Operand &op : ops)
+    {
+        all.push_back(spans(doc, op));
+        if (all.back().empty())
+            return false;
+        totalLength += (uint32_t)op.words.size();
+    }
+    std::vector<size_t> pick(ops.size(), 0);
+    while (true)
+    {
+        bool valid = true;
+        uint32_t start = UINT32_MAX, end = 0;
+        for (size_t i = 0; i < ops.size(); ++i)
+        {
+            const Span &a = all[i][pick[i]];
+            start = std::min(start, a.start);
+            end = std::max(end, a.end);
+            for (size_t j = 0; j < i; ++j)
+            {
+                const Span &b = all[j][pick[j]];
+                if (ordered ? (j + 1 == i && a.start <= b.end) : (a.start <= b.end && b.start <= a.end))
+                    valid = false;
+            }
+        }
+        if (valid && end - start + 1 - totalLength <= slop)
+            return true;
+        size_t i = 0;
+        while (i < ops.size() && ++pick[i] == all[i].size())
+            pick[i++] = 0;
+        if (i == ops.size())
+            return false;
+    }
+}
+
+std::set<uint32_t> search(const SegmentedIndex &index, const Bm25 &bm25, const std::string &query)
+{
+    QueryNode node;
+    parseQuery(query, node);
+    std::vector<ScoredDoc> results;
+    topKBoolean(index, node, bm25, index.docCount(), results);
+    std::set<uint32_t> docs;
+    for (const ScoredDoc &r : results)
+        docs.insert(r.doc);
+    return docs;
+}
+
+bool writeImage(const std::string &path, const std::vector<std::vector<int>> &docs)
+{
+    std::vector<PostingList> lists(VOCABULARY);
+    std::vector<ImageDoc> imageDocs(docs.size());
+    std::vector<std::string> names;
+    for (uint32_t d = 0; d < docs.size(); ++d)
+    {
+        for (int w = 0; w < VOCABULARY; ++w)
+        {
+            uint32_t freq = (uint32_t)std::count(docs[d].begin(), docs[d].end(), w);
+            if (freq == 0)
+                continue;
+            lists[w].docs.push_back(d);
+            lists[w].freqs.push_back(freq);
+            lists[w].fields.push_back(3);
+        }
+        names.push_back("d" + std::to_string(d));
+        imageDocs[d].fields[DOC_CORD_ID] = names.back();
+        imageDocs[d].length = (uint32_t)docs[d].size();
+    }
+
+    std::string postingsPath = path + ".postings";
+    {
+        PostingsWriter writer(postingsPath, PostingsCodec::BitPacked);
+        for (int w = 0; w < VOCABULARY; ++w)
+            if (!lists[w].docs.empty())
+                writer.addTerm(w, lists[w]);
+        writer.finish(names);
+    }
+    std::ifstream in(postingsPath, std::ios::binary);
+    std::vector<uint8_t> postingsFile((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    fs::remove(postingsPath);
+
+    std::vector<std::pair<std::string, int>> lexicon;
+    for (int w = 0; w < VOCABULARY; ++w)
+        lexicon.emplace_back(WORDS[w], w);
+    auto positions = [&](int wordID, uint32_t doc, std::vector<uint32_t> &out)
+    {
+        out.clear();
+        for (uint32_t p = 0; p < docs[doc].size(); ++p)
+            if (docs[doc][p] == wordID)
+                out.push_back(p);
+        return true;
+    };
+    return writeIndexImage(path, lexicon, postingsFile, imageDocs, positions);
+}
+} // namespace
+
+int main()
+{
+    // Fixed docs first, for the cases that used to match by overlapping
+    // a word with itself or missed a sloppy phrase's longer spans
+    std::vector<std::vector<int>> docs = {
+        {0, 1},             // alpha beta
+        {0, 1, 0},          // alpha beta alpha
+        {0, 1, 2, 1},       // alpha beta gamma beta
+        {2, 0, 1},          // gamma alpha beta
+        {1, 0, 0, 0, 1, 0}, // beta alpha alpha alpha beta alpha
+    };
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<int> word(0, VOCABULARY - 1), length(3, 25);
+    while (docs.size() < 400)
+    {
+        std::vector<int> doc(length(rng));
+        for (int &w : doc)
+            w = word(rng);
+        docs.push_back(doc);
+    }
+
+    std::string path = (fs::temp_directory_path() / "positional_test.img").string();
+    if (!writeImage(path, docs))
+    {
+        std::printf("cannot write %s\n", path.c_str());
+        return 1;
+    }
+    int failures = 0;
+    {
+        SegmentedIndex index;
+        if (!index.openImage(path))
+        {
+            std::printf("cannot open %s\n", path.c_str());
+            return 1;
+        }
+        Bm25 bm25;
+        bm25.docCount = index.docCount();
+        bm25.avgDocLength = index.avgDocLength();
+
+        auto expect = [&](const std::string &query, std::set<uint32_t> want)
+        {
+            std::set<uint32_t> got = search(index, bm25, query);
+            for (uint32_t d = 5; d < docs.size(); ++d)
+                got.erase(d);
+            if (got != want)
+            {
+                std::printf("FAIL %s on the fixed docs\n", query.c_str());
+                ++failures;
+            }
+        };
+        expect("alpha NEAR alpha", {1, 4});
+        expect("alpha NEAR/0 alpha", {4});
+        expect("alpha NEAR/1 alpha", {1, 4});
+        expect("\"alpha beta\" NEAR beta", {2, 4});
+        expect("\"alpha beta\" NEAR alpha", {1, 4});
+        expect("beta NEAR \"alpha beta\"", {2, 4});
+        expect("gamma NEAR \"alpha beta\"~1", {2, 3});
+        expect("alpha NEAR/4 \"beta beta\"~3", {2, 4});
+
+        // Random NEAR and phrase queries of 2 or 3 operands
+        size_t queries = 0;
+        for (int q = 0; q < 2000; ++q)
+        {
+            std::vector<Operand> ops(2 + q % 2);
+            for (Operand &op : ops)
+            {
+                op.words.push_back(word(rng));
+                if (rng() % 3 == 0)
+                {
+                    op.words.push_back(word(rng));
+                    if (rng() % 2 == 0)
+                        op.slop = rng() % 4;
+                }
+            }
+            uint32_t slop = rng() % 7;
+            bool ordered = q % 4 == 0;
+            std::string query;
+            if (ordered)
+            {
+                // A phrase of single words
+                for (Operand &op : ops)
+                    op.words.resize(1);
+                for (const Operand &op : ops)
+                    query += (query.empty() ? "" : " ") + std::string(WORDS[op.words[0]]);
+                query = "\"" + query + "\"~" + std::to_string(slop);
+            }
+            else
+                for (const Operand &op : ops)
+                    query += (query.empty() ? "" : " NEAR/" + std::to_string(slop) + " ") + text(op);
+
+            std::set<uint32_t> want;
+            for (uint32_t d = 0; d < docs.size(); ++d)
+                if (bruteForce(docs[d], ops, ordered, slop))
+                    want.insert(d);
+            if (search(index, bm25, query) != want)
+            {
+                std::printf("FAIL %s\n", query.c_str());
+                ++failures;
+            }
+            ++queries;
+        }
+        std::printf("%zu random queries, %d failures\n", queries, failures);
+    }
+    fs::remove(path);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+#ifndef REGEX_NORMALIZER_H
+#define REGEX_NORMALIZER_H
+
+// The regex chain TextNormalizer::normalize ran before it became a
+// single table-driven pass, kept as the reference it must agree with.
+// The regexes are compiled once here; the old code built them on every
+// call, which does not change the output.
+
+#include <algorithm>
+#include <cctype>
+#include <regex>
+#include <string>
+
+inline std::string regexNormalize(const std::string &text)
+{
+    static const std::regex atHash("([@#])");
+    static const std::regex operators("([+\\-*/=<>])");
+    static const std::regex parens("([()])");
+    static const std::regex dollar("\\$");
+    static const std::regex decimal("(\\d+)\\.(\\d+)");
+    static const std::regex comma(",");
+    static const std::regex other("[^a-z0-9\\s+\\-*/=<>()\\$@#äöüß]");
+    static const std::regex hyphen("\\s*-\\s*");
+    static const std::regex spaces("\\s+");
+
+    if (text.empty()) return "";
+
+    std::string s = text;
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    s = std::regex_replace(s, atHash, " $1 ");
+    s.erase(std::remove(s.begin(), s.end(), '\''), s.end());
+    s = std::regex_replace(s, operators, " $1 ");
+    s = std::regex_replace(s, parens, " $1 ");
+    s = std::regex_replace(s, dollar, " $ ");
+    s = std::regex_replace(s, decimal, "$1 $2");
+    s = std::regex_replace(s, comma, "");
+    s = std::regex_replace(s, other, " ");
+    s = std::regex_replace(s, hyphen, " ");
+    s = std::regex_replace(s, spaces, " ");
+    if (!s.empty() && s.front() == ' ') s.erase(0, 1);
+    if (!s.empty() && s.back() == ' ') s.pop_back();
+    return s;
+}
+
+#endif
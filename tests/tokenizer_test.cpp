@@ -0,0 +1,146 @@
+// tokenizeWords and splitWhitespace against the stringstream tokenizers
+// they replaced: letter runs lowercased (the server's old cleanText and
+// tokenize) and a plain >> split. Fixed cases put tokens across and
+// exactly on the 64-byte block boundaries; 100,000 random strings mix
+// long letter runs, whitespace, digits, punctuation and high bytes, at
+// varying alignment. Exits non-zero on a mismatch.
+
+#include "../src/tokenizer.h"
+
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::vector<std::string> oldWords(const std::string &text)
+{
+    std::string cleaned = text;
+    for (char &c : cleaned)
+    {
+        if (!isalpha((unsigned char)c))
+            c = ' ';
+        else
+            c = tolower((unsigned char)c);
+    }
+    std::vector<std::string> words;
+    std::stringstream ss(cleaned);
+    std::string word;
+    while (ss >> word)
+        words.push_back(word);
+    return words;
+}
+
+std::vector<std::string> oldWhitespace(const std::string &text)
+{
+    std::vector<std::string> tokens;
+    std::stringstream ss(text);
+    std::string word;
+    while (ss >> word)
+        tokens.push_back(word);
+    return tokens;
+}
+
+bool same(const std::vector<std::string_view> &got, const std::vector<std::string> &want)
+{
+    if (got.size() != want.size())
+        return false;
+    for (size_t i = 0; i < got.size(); ++i)
+        if (got[i] != want[i])
+            return false;
+    return true;
+}
+
+std::string printable(const std::string &s)
+{
+    std::string out;
+    char hex[8];
+    for (unsigned char c : s)
+    {
+        if (c >= 0x20 && c < 0x7F)
+            out += (char)c;
+        else
+        {
+            std::snprintf(hex, sizeof(hex), "\\x%02X", c);
+            out += hex;
+        }
+    }
+    return out;
+}
+} // namespace
+
+int main()
+{
+    std::vector<std::string> cases = {
+        "",
+        " ",
+        "a",
+        "Hello, World! COVID-19 SARS-CoV-2",
+        "tab\there\nnewline\r\nend\v\f",
+        "caf\xC3\xA9 na\xC3\xAFve \xE2\x80\x94 Gr\xC3\xB6\xC3\x9F" "e",
+        "\x80\xFF\xC0Z\xDA\x9A" "a\xE1",
+        std::string(64, 'a'),
+        std::string(128, 'Q'),
+        std::string(63, ' ') + "ab",
+        std::string(63, 'x') + " " + std::string(64, 'y'),
+        std::string(62, '.') + "Word" + std::string(60, '.') + "end",
+        std::string(64, ' ') + "z",
+        std::string(200, 'k') + "\xC3\xA9" + std::string(100, 'K'),
+        std::string(63, '\xE9') + "a" + std::string(64, '\xE9'),
+    };
+
+    // Long runs of one kind, so tokens often cross a block boundary
+    const std::string punctuation = "@#+-*/=<>()$'.,;:!?\"%&_[]{}|\\~^`";
+    const std::string spaces = " \t\n\r\v\f";
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<int> pieces(0, 40), kind(0, 9), runLength(1, 90), byte(0, 255);
+    while (cases.size() < 100000)
+    {
+        std::string s;
+        for (int n = pieces(rng); n > 0; --n)
+        {
+            int k = kind(rng);
+            int run = k < 4 ? runLength(rng) : 1 + (int)(rng() % 4);
+            for (int i = 0; i < run; ++i)
+            {
+                if (k < 4)
+                    s += (char)('a' + rng() % 26 - (rng() % 3 == 0 ? 32 : 0));
+                else if (k < 6)
+                    s += spaces[rng() % spaces.size()];
+                else if (k < 7)
+                    s += (char)('0' + rng() % 10);
+                else if (k < 8)
+                    s += punctuation[rng() % punctuation.size()];
+                else
+                    s += (char)byte(rng);
+            }
+        }
+        cases.push_back(s);
+    }
+
+    int failures = 0;
+    std::string buffer, lowered;
+    std::vector<std::string_view> tokens;
+    for (size_t c = 0; c < cases.size(); ++c)
+    {
+        const std::string &text = cases[c];
+        // A random start in a larger buffer, so blocks fall at any alignment
+        size_t shift = rng() % 32;
+        buffer.assign(shift, 'A');
+        buffer += text;
+        buffer.append(rng() % 32, 'A');
+        std::string_view view(buffer.data() + shift, text.size());
+
+        tokenizeWords(view, lowered, tokens);
+        if (!same(tokens, oldWords(text)) && ++failures <= 10)
+            std::printf("FAIL tokenizeWords \"%s\"\n", printable(text).c_str());
+        splitWhitespace(view, tokens);
+        if (!same(tokens, oldWhitespace(text)) && ++failures <= 10)
+            std::printf("FAIL splitWhitespace \"%s\"\n", printable(text).c_str());
+    }
+    std::printf("%zu cases, %d failures\n", cases.size(), failures);
+    return failures == 0 ? 0 : 1;
+}